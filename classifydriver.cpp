@@ -0,0 +1,213 @@
+#include "classifydriver.h"
+
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+ClassifyDriver::ClassifyDriver(size_t num_threads, size_t size)
+    : writer(false) {
+  threads = num_threads > 0 ? num_threads : 1;
+  chunk_size = size > 0 ? size : 1;
+}
+
+ClassifyDriver::~ClassifyDriver() {}
+
+bool ClassifyDriver::Run(const Corpus &test_corpus, std::string results_dir,
+  ClassifyChunk classify) {
+
+  corpus = &test_corpus;
+  results_file = results_dir;
+  classify_chunk = classify;
+  docs = test_corpus.Size();
+
+  results.assign(docs, 0);
+  done.assign(docs, 0);
+  next_write = 0;
+  failed = false;
+  output.clear();
+  output.reserve(output_buffer_size);
+
+  // Give every worker an equal share of the chunks, in ascending order.
+  size_t chunks = (docs + chunk_size - 1) / chunk_size;
+  std::vector<WorkQueue> fresh_queues(threads);
+  queues.swap(fresh_queues);
+  for ( size_t w = 0; w < threads; w++ ) {
+    for ( size_t c = w * chunks / threads; c < (w + 1) * chunks / threads;
+        c++ ) {
+      queues[w].chunks.push_back(c);
+    }
+  }
+
+  bool return_value = true;
+
+  if ( threads == 1 ) {
+    size_t chunk;
+    while ( return_value == true && TakeChunk(0, chunk) == true ) {
+      return_value = ClassifyOne(chunk) && WriteReady(false);
+    }
+    return_value = return_value && WriteReady(false);
+  }
+  else {
+    std::vector<std::thread> workers;
+    for ( size_t w = 0; w < threads; w++ ) {
+      workers.push_back(std::thread(&ClassifyDriver::Work, this, w));
+    }
+
+    return_value = WriteReady(true);
+
+    // If the results could not be written, stop the workers.
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if ( return_value == false ) {
+        failed = true;
+      }
+    }
+    for ( size_t w = 0; w < workers.size(); w++ ) {
+      workers.at(w).join();
+    }
+  }
+
+  return_value = return_value && FlushOutput();
+
+  if ( return_value == true ) {
+    std::cout << '\r' << "\tParsed " << docs << " files from ";
+    std::cout << test_corpus.GetDirectory() << std::endl;
+  }
+
+  return return_value;
+}
+
+// Every worker classifies chunks until there are none left anywhere, or a
+// chunk failed.
+void ClassifyDriver::Work(size_t worker) {
+  size_t chunk;
+  while ( TakeChunk(worker, chunk) == true ) {
+    if ( ClassifyOne(chunk) == false ) {
+      return;
+    }
+  }
+}
+
+// Takes the next chunk of the worker, or steals the last chunk of another
+// worker, starting from the next one. No chunk is ever added back, so once
+// every queue is found empty, the worker is done.
+bool ClassifyDriver::TakeChunk(size_t worker, size_t &chunk) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if ( failed == true ) {
+      return false;
+    }
+  }
+
+  {
+    WorkQueue &own = queues[worker];
+    std::unique_lock<std::mutex> lock(own.mutex);
+    if ( own.chunks.empty() == false ) {
+      chunk = own.chunks.front();
+      own.chunks.pop_front();
+      return true;
+    }
+  }
+
+  for ( size_t i = 1; i < threads; i++ ) {
+    WorkQueue &victim = queues[(worker + i) % threads];
+    std::unique_lock<std::mutex> lock(victim.mutex);
+    if ( victim.chunks.empty() == false ) {
+      chunk = victim.chunks.back();
+      victim.chunks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Classifies the documents of a chunk in their cells of the reorder
+// buffer, and marks them as done for the writer.
+bool ClassifyDriver::ClassifyOne(size_t chunk) {
+  size_t first = chunk * chunk_size;
+  size_t last = std::min(first + chunk_size, docs);
+
+  bool succeeded = classify_chunk(first, last, &results[first]);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if ( succeeded == true ) {
+      for ( size_t index = first; index < last; index++ ) {
+        done[index] = 1;
+      }
+    }
+    else {
+      failed = true;
+    }
+  }
+  chunk_done.notify_all();
+
+  return succeeded;
+}
+
+// Appends the results of the documents that follow the last document
+// written in the output buffer, as long as they are done. If wait is set,
+// waits for the remaining documents until every document is written.
+// Fails if a chunk failed, or the results file could not be written.
+bool ClassifyDriver::WriteReady(bool wait) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while ( next_write < docs ) {
+
+    if ( done[next_write] == 0 ) {
+      if ( failed == true ) {
+        return false;
+      }
+      if ( wait == false ) {
+        return true;
+      }
+      chunk_done.wait(lock);
+      continue;
+    }
+
+    size_t first = next_write;
+    size_t last = first;
+    while ( last < docs && done[last] != 0 ) {
+      last++;
+    }
+
+    // The results of the done documents are never written again by the
+    // workers, so they are read without holding the lock.
+    lock.unlock();
+
+    // Append the results in the output buffer.
+    for ( size_t index = first; index < last; index++ ) {
+      output += corpus->GetFile(index).substr(0, 5);
+      output += ' ';
+      output += std::to_string(results[index]);
+      output += '\n';
+
+      // Have a counter notifying the user about the progress.
+      if ( index % 10 == 0) {
+        std::cout << "\r\t" << index;
+        fflush(stdout);
+      }
+    }
+    if ( output.size() >= output_buffer_size && FlushOutput() == false ) {
+      return false;
+    }
+
+    lock.lock();
+    next_write = last;
+  }
+
+  return failed == false;
+}
+
+// Appends the output buffer in the results file.
+bool ClassifyDriver::FlushOutput() {
+  if ( output.empty() ) {
+    return true;
+  }
+
+  std::string buffer;
+  buffer.reserve(output_buffer_size);
+  buffer.swap(output);
+  return writer.Write(results_file, std::move(buffer), true);
+}
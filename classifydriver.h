@@ -0,0 +1,80 @@
+#ifndef CLASSIFYDRIVER_H
+#define CLASSIFYDRIVER_H
+
+#include "corpus.h"
+#include "outputwriter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Classifies the testing documents first up to last - 1, storing the result
+// of every document in the results, 1 for positive and 0 for negative.
+// Called by many threads at the same time, for different documents.
+typedef std::function<bool(size_t first, size_t last, int *results)>
+    ClassifyChunk;
+
+// Classifies the testing documents of a corpus, shared by every method.
+// The documents are split in chunks of chunk_size documents, and every
+// worker thread starts with an equal share of the chunks, in ascending
+// order. A worker takes its own chunks from the front, and once it runs
+// out, steals the chunks of the other workers from the back, so the
+// workers keep busy however long the documents are. The results wait in
+// a reorder buffer, and the calling thread appends them in an output
+// buffer in the order of the documents, so the file is the same for any
+// number of threads. The output buffer is appended in the results file
+// whenever it fills up, and once every document is classified. With a
+// single thread, no worker is started and the chunks are classified on
+// the calling thread.
+class ClassifyDriver {
+public:
+  ClassifyDriver(size_t threads, size_t chunk_size);
+  ~ClassifyDriver();
+
+  bool Run(const Corpus &test_corpus, std::string results_dir,
+      ClassifyChunk classify);
+
+private:
+  // The chunks of a worker, stolen from the back by the other workers.
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> chunks;
+  };
+
+  void Work(size_t worker);
+  bool TakeChunk(size_t worker, size_t &chunk);
+  bool ClassifyOne(size_t chunk);
+  bool WriteReady(bool wait);
+  bool FlushOutput();
+
+  size_t threads;
+  size_t chunk_size;
+
+  // The state of the current run.
+  const Corpus *corpus = nullptr;
+  std::string results_file;
+  ClassifyChunk classify_chunk;
+  size_t docs = 0;
+  std::vector<WorkQueue> queues;
+
+  // The reorder buffer. The result of every document, whether the chunk
+  // of every document was classified, and the first document not written
+  // yet. A failed chunk stops the workers and the writer.
+  std::vector<int> results;
+  std::vector<char> done;
+  size_t next_write = 0;
+  bool failed = false;
+
+  // The lines of the written documents, not appended in the results file
+  // yet.
+  std::string output;
+  OutputWriter writer;
+
+  std::mutex mutex;
+  std::condition_variable chunk_done;
+};
+
+#endif
@@ -0,0 +1,682 @@
+#include "classifyserver.h"
+#include "tokenizer.h"
+#include "threadpool.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <limits>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Set by SIGINT and SIGTERM, or SIGHUP, which also write in the pipe,
+// waking up the thread waiting for new connections.
+static volatile sig_atomic_t stop_requested = 0;
+static volatile sig_atomic_t reload_requested = 0;
+static int signal_pipe[2] = {-1, -1};
+
+static void HandleSignal(int signal_number) {
+  if ( signal_number == SIGHUP ) {
+    reload_requested = 1;
+  }
+  else {
+    stop_requested = 1;
+  }
+  ssize_t unused = write(signal_pipe[1], "", 1);
+  (void) unused;
+}
+
+// Sends as much of the buffer as the socket takes without waiting, and
+// removes it from the buffer. Returns false if the client is gone, without
+// raising SIGPIPE.
+static bool SendSome(int connection, std::string &buffer) {
+  size_t sent_size = 0;
+  while ( sent_size < buffer.size() ) {
+    ssize_t sent = send(connection, buffer.data() + sent_size,
+        buffer.size() - sent_size, MSG_NOSIGNAL);
+    if ( sent < 0 && errno == EINTR ) {
+      continue;
+    }
+    if ( sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+      break;
+    }
+    if ( sent <= 0 ) {
+      return false;
+    }
+    sent_size += sent;
+  }
+  buffer.erase(0, sent_size);
+  return true;
+}
+
+static bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Wakes up the thread waiting on the connections, so it waits on them
+// again with their new state.
+static void Wake() {
+  ssize_t unused = write(signal_pipe[1], "", 1);
+  (void) unused;
+}
+ServedModel::ServedModel(Vocabulary &vocab, const Model &model,
+  size_t threads, const KNNOptions &knn_options)
+    : vocabulary(vocab), corpus(1, vocab),
+      means("", corpus, "", model, threads),
+      tags("", corpus, "", model, threads),
+      knn("", corpus, "", model, threads, knn_options) {
+  vocab.Freeze();
+}
+
+ServedModel::ServedModel(std::unique_ptr<LoadedModel> loaded_model,
+  size_t threads, const KNNOptions &knn_options)
+    : ServedModel(loaded_model->vocabulary, loaded_model->model, threads,
+        knn_options) {
+  loaded = std::move(loaded_model);
+}
+
+ServedModel::~ServedModel() {}
+
+// Prepares the methods that need it, before any request is answered.
+bool ServedModel::Prepare() {
+  return means.SumVectors() && knn.CreateSearch();
+}
+
+// Classifies the raw text of a document with the given method.
+std::string ServedModel::Answer(std::string_view method, std::string text) {
+
+  std::vector<std::string_view> words;
+  TokenizeRaw(text.data(), text.size(), words);
+
+  std::vector<WordId> ids;
+  GetWordIds(words, ids);
+
+  int result = 0;
+  bool succeeded = true;
+  if ( method == "means" ) {
+    succeeded = means.ClassifyDocument(ids, result);
+  }
+  else if ( method == "tags" ) {
+    result = tags.ClassifyDocument(ids);
+  }
+  else if ( method == "knn" ) {
+    succeeded = knn.ClassifyDocument(ids, result);
+  }
+  else {
+    return "error unknown method " + std::string(method) + "\n";
+  }
+
+  if ( succeeded == false ) {
+    return "error could not classify the document\n";
+  }
+
+  return std::to_string(result) + "\n";
+}
+
+// Gives every word the ID it has in the vocabulary, which is frozen while
+// serving, so the words are looked up without locking. The words missing
+// from it are given new IDs after the last ID of the vocabulary, the same
+// ID for every appearance.
+void ServedModel::GetWordIds(const std::vector<std::string_view> &words,
+  std::vector<WordId> &ids) const {
+
+  WordId next_id = vocabulary.Size();
+  std::unordered_map<std::string_view, WordId> new_words;
+
+  ids.clear();
+  ids.reserve(words.size());
+  for ( size_t i = 0; i < words.size(); i++ ) {
+    WordId id;
+    if ( vocabulary.Find(words[i], id) == false ) {
+      auto inserted = new_words.insert(std::make_pair(words[i], next_id));
+      if ( inserted.second == true ) {
+        next_id++;
+      }
+      id = inserted.first->second;
+    }
+    ids.push_back(id);
+  }
+}
+
+ClassifyServer::ClassifyServer(std::unique_ptr<ServedModel> model,
+  std::string path, size_t num_threads, const KNNOptions &options)
+    : model_path(path), knn_options(options) {
+  threads = num_threads > 0 ? num_threads : 1;
+  served = Share(std::move(model));
+}
+
+// The model is released before the members its deleter uses.
+ClassifyServer::~ClassifyServer() {
+  served.reset();
+}
+
+// Shares a model among the requests. Whichever request drops the model
+// last hands it to the background thread, instead of freeing it itself.
+std::shared_ptr<ServedModel> ClassifyServer::Share(
+  std::unique_ptr<ServedModel> model) {
+  return std::shared_ptr<ServedModel>(model.release(),
+      [this](ServedModel *released) { Retire(released); });
+}
+
+// Queues a model no request holds anymore for the background thread, or
+// frees it right away when the background thread is not running.
+void ClassifyServer::Retire(ServedModel *model) {
+  {
+    std::unique_lock<std::mutex> lock(reload_mutex);
+    if ( stopping == false ) {
+      retired.push_back(model);
+      model = nullptr;
+    }
+  }
+  reload_ready.notify_one();
+
+  delete model;
+}
+
+// Creates the socket and listens on it. A socket left behind by a
+// previous server is replaced, but any other file is left alone.
+int ClassifyServer::Listen(std::string socket_path) {
+
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if ( socket_path.size() >= sizeof(address.sun_path) ) {
+    std::cout << "\tError: The socket path " << socket_path;
+    std::cout << " is too long." << std::endl;
+    return -1;
+  }
+  socket_path.copy(address.sun_path, socket_path.size());
+
+  struct stat file_stat;
+  if ( lstat(socket_path.c_str(), &file_stat) == 0 ) {
+    if ( S_ISSOCK(file_stat.st_mode) == false ) {
+      std::cout << "\tError: " << socket_path << " exists and is not a ";
+      std::cout << "socket." << std::endl;
+      return -1;
+    }
+    unlink(socket_path.c_str());
+  }
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ( listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address)) != 0 ||
+      listen(listener, SOMAXCONN) != 0 ) {
+    std::cout << "\tError: Could not listen on " << socket_path << ": ";
+    std::cout << strerror(errno) << std::endl;
+    if ( listener >= 0 ) {
+      close(listener);
+    }
+    return -1;
+  }
+
+  return listener;
+}
+
+// Waits on the listening socket and on every connection at once, until
+// the server is asked to stop. New clients are accepted, the requests
+// received are handed to the pool a batch at a time, and the answers the
+// sockets had no room for are sent once they have. The connections still
+// open are then closed once their batches are answered, and the socket is
+// removed.
+bool ClassifyServer::Run(std::string socket_path) {
+
+  int listener = Listen(socket_path);
+  if ( listener < 0 ) {
+    return false;
+  }
+
+  if ( pipe(signal_pipe) != 0 || SetNonBlocking(signal_pipe[0]) == false ||
+      SetNonBlocking(signal_pipe[1]) == false ||
+      SetNonBlocking(listener) == false ) {
+    std::cout << "\tError: Could not create the signal pipe." << std::endl;
+    close(listener);
+    unlink(socket_path.c_str());
+    return false;
+  }
+
+  // The handler does not restart the calls it interrupts, so the waiting
+  // thread notices the stop.
+  stop_requested = 0;
+  reload_requested = 0;
+  struct sigaction action, old_int, old_term, old_hup;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = HandleSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, &old_int);
+  sigaction(SIGTERM, &action, &old_term);
+  sigaction(SIGHUP, &action, &old_hup);
+
+  stopping = false;
+  reloader = std::thread(&ClassifyServer::Reload, this);
+
+  std::cout << "\tListening on " << socket_path << std::endl;
+
+  bool return_value = true;
+  {
+    // Every batch runs on a worker, even with a single thread, so this
+    // thread never waits for one. A connection has at most one batch in
+    // the queue, so submitting never waits either.
+    ThreadPool workers(threads, std::numeric_limits<size_t>::max(), true);
+    pool = &workers;
+
+    while ( stop_requested == 0 ) {
+
+      std::vector<pollfd> waiting = {{listener, POLLIN, 0},
+          {signal_pipe[0], POLLIN, 0}};
+      std::vector<std::pair<int, std::string>> batches;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = connections.begin();
+        while ( it != connections.end() ) {
+          int connection = it->first;
+          Connection &client = it->second;
+
+          std::string requests;
+          if ( TakeRequests(client, requests) == true ) {
+            batches.push_back(std::make_pair(connection,
+                  std::move(requests)));
+          }
+
+          // Once everything before it is answered, a request too long is
+          // answered with an error, and the connection is closed.
+          bool idle = client.taken == false && client.unsent.empty();
+          if ( idle == true && client.too_long == true &&
+              client.failed == false ) {
+            client.unsent = "error request too long\n";
+            client.received.clear();
+            client.too_long = false;
+            client.closed = true;
+            WriteAnswers(connection, client);
+            idle = client.unsent.empty();
+          }
+          if ( idle == true && (client.closed || client.failed) ) {
+            close(connection);
+            it = connections.erase(it);
+            continue;
+          }
+
+          short events = 0;
+          if ( client.closed == false && client.too_long == false &&
+              client.failed == false && client.unsent.empty() &&
+              client.received.size() <= max_request_size ) {
+            events |= POLLIN;
+          }
+          if ( client.taken == false && client.unsent.empty() == false ) {
+            events |= POLLOUT;
+          }
+          if ( events != 0 ) {
+            waiting.push_back({connection, events, 0});
+          }
+          ++it;
+        }
+      }
+
+      for ( size_t i = 0; i < batches.size(); i++ ) {
+        int connection = batches[i].first;
+        std::string requests = std::move(batches[i].second);
+        pool->Submit([this, connection, requests] {
+          Serve(connection, requests);
+        });
+      }
+
+      if ( poll(waiting.data(), waiting.size(), -1) < 0 ) {
+        if ( errno == EINTR ) {
+          continue;
+        }
+        return_value = false;
+        break;
+      }
+
+      if ( waiting[1].revents != 0 ) {
+        char signals[64];
+        while ( read(signal_pipe[0], signals, sizeof(signals)) > 0 ) {}
+        if ( reload_requested != 0 && stop_requested == 0 ) {
+          reload_requested = 0;
+          if ( model_path == "" ) {
+            std::cout << "\tError: No model file to reload." << std::endl;
+          }
+          else {
+            RequestReload(model_path, nullptr);
+          }
+        }
+      }
+
+      std::unique_lock<std::mutex> lock(mutex);
+
+      for ( size_t i = 2; i < waiting.size(); i++ ) {
+        if ( waiting[i].revents == 0 ) {
+          continue;
+        }
+        int connection = waiting[i].fd;
+        Connection &client = connections.at(connection);
+        if ( (waiting[i].events & POLLOUT) != 0 ) {
+          WriteAnswers(connection, client);
+        }
+        if ( (waiting[i].events & POLLIN) != 0 ) {
+          ReadRequests(connection, client);
+        }
+      }
+
+      while ( waiting[0].revents != 0 ) {
+        int connection = accept(listener, nullptr, nullptr);
+        if ( connection < 0 ) {
+          if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+            break;
+          }
+          if ( errno == EINTR || errno == ECONNABORTED ) {
+            continue;
+          }
+          std::cout << "\tError: Could not accept a connection: ";
+          std::cout << strerror(errno) << std::endl;
+          return_value = false;
+          break;
+        }
+        if ( SetNonBlocking(connection) == false ) {
+          close(connection);
+          continue;
+        }
+        connections[connection] = Connection();
+      }
+      if ( return_value == false ) {
+        break;
+      }
+    }
+
+    // Stop the background thread first, failing the reloads still
+    // waiting, so no batch waits for a reload.
+    {
+      std::unique_lock<std::mutex> lock(reload_mutex);
+      stopping = true;
+    }
+    reload_ready.notify_all();
+    reloader.join();
+
+    workers.Wait();
+    pool = nullptr;
+
+    for ( auto &it : connections ) {
+      close(it.first);
+    }
+    connections.clear();
+  }
+
+  sigaction(SIGINT, &old_int, nullptr);
+  sigaction(SIGTERM, &old_term, nullptr);
+  sigaction(SIGHUP, &old_hup, nullptr);
+  close(signal_pipe[0]);
+  close(signal_pipe[1]);
+  close(listener);
+  unlink(socket_path.c_str());
+
+  std::cout << "\tStopped listening on " << socket_path << std::endl;
+
+  return return_value;
+}
+
+// Reads whatever the client sent, without waiting, until the requests
+// received reach the longest request. A request longer than that is
+// noted, and nothing more is read.
+void ClassifyServer::ReadRequests(int connection, Connection &client) {
+
+  char buffer[64 * 1024];
+
+  while ( client.received.size() <= max_request_size ) {
+    ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+    if ( received < 0 && errno == EINTR ) {
+      continue;
+    }
+    if ( received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+      break;
+    }
+    if ( received < 0 ) {
+      client.failed = true;
+      break;
+    }
+    if ( received == 0 ) {
+      client.closed = true;
+      break;
+    }
+    client.received.append(buffer, received);
+  }
+
+  size_t end = client.received.rfind('\n');
+  size_t incomplete = end == std::string::npos ? client.received.size() :
+      client.received.size() - end - 1;
+  if ( incomplete > max_request_size ) {
+    client.too_long = true;
+  }
+}
+
+// Sends the answers the socket had no room for, once it has.
+void ClassifyServer::WriteAnswers(int connection, Connection &client) {
+  if ( SendSome(connection, client.unsent) == false ) {
+    client.failed = true;
+    client.unsent.clear();
+  }
+}
+
+// Takes every complete request received, unless a batch of the client is
+// already taken, or its answers are not all sent, so the answers go out
+// in the order of the requests. Must be called with the mutex locked.
+bool ClassifyServer::TakeRequests(Connection &client,
+  std::string &requests) {
+
+  if ( client.taken == true || client.unsent.empty() == false ||
+      client.failed == true ) {
+    return false;
+  }
+
+  size_t end = client.received.rfind('\n');
+  if ( end == std::string::npos ) {
+    return false;
+  }
+
+  requests = client.received.substr(0, end + 1);
+  client.received.erase(0, end + 1);
+  client.taken = true;
+  return true;
+}
+
+// Answers a batch of requests on a thread of the pool. A reload hands the
+// rest of the batch to the background thread, which hands it back once
+// the model is served, so no thread of the pool waits for the reload.
+void ClassifyServer::Serve(int connection, std::string requests) {
+
+  std::string answers;
+  size_t start = 0;
+  size_t end;
+  while ( (end = requests.find('\n', start)) != std::string::npos ) {
+
+    std::string_view request = std::string_view(requests).substr(start,
+        end - start);
+    start = end + 1;
+    if ( request.empty() == false && request.back() == '\r' ) {
+      request.remove_suffix(1);
+    }
+
+    size_t space = request.find(' ');
+    std::string_view method = request.substr(0, space);
+
+    // The text is copied, since the tokenizer makes it lowercase in place.
+    std::string text;
+    if ( space != std::string_view::npos ) {
+      text = request.substr(space + 1);
+    }
+
+    // Only the model file given at startup is reloaded, so a client can
+    // not make the server map any other file.
+    if ( method == "reload" ) {
+      if ( text != "" ) {
+        answers += "error reload takes no file\n";
+        continue;
+      }
+      if ( model_path == "" ) {
+        answers += "error no model file to reload\n";
+        continue;
+      }
+      std::string rest = requests.substr(start);
+      RequestReload(model_path, [this, connection, rest, answers]
+        (bool served) {
+        std::string reloaded = answers + (served ? "ok\n" :
+            "error could not load the model file\n");
+        Finish(connection, rest, reloaded);
+      });
+      return;
+    }
+
+    answers += Answer(method, text);
+  }
+
+  Finish(connection, "", answers);
+}
+
+// Sends the answers of a batch, still taken, so no other thread sends on
+// the socket, and gives back the requests not answered. The next batch of
+// the client is answered right away, if there is one and the socket took
+// every answer, and the waiting thread is woken up otherwise.
+void ClassifyServer::Finish(int connection, std::string rest,
+  std::string answers) {
+
+  bool sent = SendSome(connection, answers);
+
+  std::string requests;
+  bool next;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    Connection &client = connections.at(connection);
+    client.received.insert(0, rest);
+    if ( sent == false ) {
+      client.failed = true;
+      answers.clear();
+    }
+    client.unsent = answers;
+    client.taken = false;
+    next = TakeRequests(client, requests);
+  }
+
+  if ( next == true ) {
+    pool->Submit([this, connection, requests] {
+      Serve(connection, requests);
+    });
+  }
+  else {
+    Wake();
+  }
+}
+
+// Classifies the text of a request with the method it names.
+std::string ClassifyServer::Answer(std::string_view method,
+  std::string text) {
+
+  // The request keeps the model it starts with, even if another model is
+  // published meanwhile.
+  std::shared_ptr<ServedModel> model = std::atomic_load(&served);
+  return model->Answer(method, text);
+}
+
+// Hands a model file to the background thread, which calls done, if
+// given, once the model is served, or could not be.
+void ClassifyServer::RequestReload(std::string path,
+  std::function<void(bool served)> done) {
+
+  ReloadRequest request;
+  request.path = path;
+  request.done = done;
+
+  {
+    std::unique_lock<std::mutex> lock(reload_mutex);
+    if ( stopping == false ) {
+      reloads.push_back(std::move(request));
+      request.done = nullptr;
+    }
+  }
+  reload_ready.notify_one();
+
+  if ( request.done ) {
+    request.done(false);
+  }
+}
+
+// The background thread loads the model files one at a time, and frees
+// the models retired meanwhile, until the server stops. The files still
+// waiting then are not loaded.
+void ClassifyServer::Reload() {
+  while ( true ) {
+
+    ReloadRequest request;
+    std::deque<ReloadRequest> dropped;
+    std::deque<ServedModel*> released;
+    bool stop;
+    bool reload = false;
+    {
+      std::unique_lock<std::mutex> lock(reload_mutex);
+      reload_ready.wait(lock, [this] {
+        return stopping || !reloads.empty() || !retired.empty();
+      });
+      released.swap(retired);
+      stop = stopping;
+      if ( stop == true ) {
+        dropped.swap(reloads);
+      }
+      else if ( reloads.empty() == false ) {
+        request = std::move(reloads.front());
+        reloads.pop_front();
+        reload = true;
+      }
+    }
+
+    for ( size_t i = 0; i < released.size(); i++ ) {
+      delete released[i];
+    }
+
+    if ( stop == true ) {
+      for ( size_t i = 0; i < dropped.size(); i++ ) {
+        if ( dropped[i].done ) {
+          dropped[i].done(false);
+        }
+      }
+      return;
+    }
+
+    if ( reload == true ) {
+      bool served = ReloadModel(request.path);
+      if ( request.done ) {
+        request.done(served);
+      }
+    }
+  }
+}
+
+// Loads and prepares a model, with a vocabulary of its own, while the
+// requests are answered with the current model, and then publishes it.
+// The old model is retired by the last request that started with it, and
+// freed on this thread, so no request waits for it to be freed.
+bool ClassifyServer::ReloadModel(std::string path) {
+
+  std::cout << "\tLoading the model from " << path << std::endl;
+
+  std::unique_ptr<LoadedModel> loaded(new LoadedModel);
+  if ( loaded->model.Load(path, loaded->vocabulary) == false ) {
+    return false;
+  }
+
+  std::unique_ptr<ServedModel> model(new ServedModel(std::move(loaded),
+        threads, knn_options));
+  if ( model->Prepare() == false ) {
+    std::cout << "\tError: Could not prepare the methods." << std::endl;
+    return false;
+  }
+
+  std::atomic_store(&served, Share(std::move(model)));
+
+  std::cout << "\tServing the model from " << path << std::endl;
+  return true;
+}
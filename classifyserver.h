@@ -0,0 +1,173 @@
+#ifndef CLASSIFYSERVER_H
+#define CLASSIFYSERVER_H
+
+#include "corpus.h"
+#include "vocabulary.h"
+#include "model.h"
+#include "meansmethod.h"
+#include "tagsmethod.h"
+#include "knnmethod.h"
+#include "threadpool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The longest request accepted, in bytes. A client sending a longer line
+// is answered with an error and disconnected.
+const size_t max_request_size = 1024 * 1024;
+
+// The vocabulary and the model read from a model file by the server.
+struct LoadedModel {
+  Vocabulary vocabulary;
+  Model model;
+};
+
+// Everything the requests are classified with: the vocabulary giving the
+// IDs of the words, frozen once given, the model, and the methods prepared
+// on it. It is never changed once prepared, so every thread shares it,
+// and the server replaces it as a whole. A model loaded by the server is
+// owned by it, any other model must outlive it.
+class ServedModel {
+public:
+  ServedModel(Vocabulary &vocabulary, const Model &model, size_t threads,
+      const KNNOptions &knn_options);
+  ServedModel(std::unique_ptr<LoadedModel> loaded_model, size_t threads,
+      const KNNOptions &knn_options);
+  ~ServedModel();
+
+  ServedModel(const ServedModel &) = delete;
+  ServedModel &operator=(const ServedModel &) = delete;
+
+  bool Prepare();
+  std::string Answer(std::string_view method, std::string text);
+
+private:
+  void GetWordIds(const std::vector<std::string_view> &words,
+      std::vector<WordId> &ids) const;
+
+  std::unique_ptr<LoadedModel> loaded;
+  const Vocabulary &vocabulary;
+
+  // The methods never read a testing document, so they are given an
+  // empty corpus, and never write their results files.
+  Corpus corpus;
+  MeansMethod means;
+  TagsMethod tags;
+  KNNMethod knn;
+};
+
+// Answers the classification requests of the clients of a Unix domain
+// socket, with a model that is trained or loaded once. Every request is a
+// line holding the name of a method (means, tags or knn), a space, and
+// the raw text of a single document. It is answered with a line holding
+// 1 for positive, 0 for negative, or "error" followed by the reason. A
+// client can send any number of requests on the same connection, and
+// they are answered in order. The text is tokenized like a raw document,
+// and the words missing from the vocabulary get IDs of their own, which
+// are part of no term of the model, so the document gets the same result
+// as it would as a testing document. A single thread waits on every
+// connection at once, reading whatever the clients send without blocking,
+// and hands the complete requests of a connection to a pool of threads,
+// one batch per connection at a time, so the answers keep their order.
+// An idle connection holds no thread, and as many clients as threads are
+// answered at the same time. The server runs until it gets SIGINT or
+// SIGTERM.
+//
+// The model is replaced without stopping, when the request "reload" is
+// received, answered with "ok" once the new model is served, or when the
+// server gets SIGHUP. Only the model file given at startup is reloaded,
+// never a file named by a client. The model file is loaded and prepared
+// by a background thread, and published with an atomic swap of the
+// shared pointer every request starts from. The requests running
+// meanwhile keep the model they started with. The last of them to drop
+// the old model hands it to the background thread, which frees it.
+class ClassifyServer {
+public:
+  ClassifyServer(std::unique_ptr<ServedModel> model, std::string model_path,
+      size_t threads, const KNNOptions &knn_options);
+  ~ClassifyServer();
+
+  bool Run(std::string socket_path);
+
+private:
+  // A model file waiting for the background thread, and what to do once
+  // it is served, or could not be.
+  struct ReloadRequest {
+    std::string path;
+    std::function<void(bool served)> done;
+  };
+
+  // The state of a client. The waiting thread reads the requests, and
+  // sends the answers when the socket was full, while no batch is taken.
+  // A thread of the pool answers a batch, and sends its answers, while
+  // it is taken.
+  struct Connection {
+    // The bytes received and not handed to the pool yet, the last request
+    // maybe incomplete.
+    std::string received;
+
+    // The answers waiting for the socket to have room.
+    std::string unsent;
+
+    // Whether a batch of requests is being answered.
+    bool taken = false;
+
+    // Whether the client is done sending, or sent a request too long, or
+    // the connection failed, in which case nothing more is sent.
+    bool closed = false;
+    bool too_long = false;
+    bool failed = false;
+  };
+
+  int Listen(std::string socket_path);
+  void ReadRequests(int connection, Connection &client);
+  void WriteAnswers(int connection, Connection &client);
+  bool TakeRequests(Connection &client, std::string &requests);
+  void Serve(int connection, std::string requests);
+  void Finish(int connection, std::string rest, std::string answers);
+  std::string Answer(std::string_view method, std::string text);
+
+  void RequestReload(std::string path,
+      std::function<void(bool served)> done);
+  void Reload();
+  bool ReloadModel(std::string path);
+  std::shared_ptr<ServedModel> Share(std::unique_ptr<ServedModel> model);
+  void Retire(ServedModel *model);
+
+  // The model every request starts from. Only read and replaced with the
+  // atomic operations of the shared pointers.
+  std::shared_ptr<ServedModel> served;
+
+  // The model file reloaded by SIGHUP or a reload request, and the
+  // options the loaded models are prepared with.
+  std::string model_path;
+  size_t threads;
+  KNNOptions knn_options;
+
+  // The connections accepted and not closed yet, by their socket.
+  std::unordered_map<int, Connection> connections;
+  std::mutex mutex;
+
+  // The threads answering the batches of requests, while running.
+  ThreadPool *pool = nullptr;
+
+  // The model files waiting for the background thread, and the models no
+  // request holds anymore, which it frees. Stopping is set while the
+  // background thread is not running.
+  std::thread reloader;
+  std::deque<ReloadRequest> reloads;
+  std::deque<ServedModel*> retired;
+  bool stopping = true;
+  std::mutex reload_mutex;
+  std::condition_variable reload_ready;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "corpus.h"
+#include "tokenizer.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+
+#include <iostream>
+
+Corpus::Corpus(size_t num_threads, Vocabulary &vocab)
+    : vocabulary(vocab) {
+  threads = num_threads > 0 ? num_threads : 1;
+}
+
+Corpus::~Corpus() {}
+
+// Parses the raw documents in the given directory, removing any
+// common words, punctuations, and makes at letters lowercase.
+// If an output directory is given, the parsed documents are also
+// written in it.
+bool Corpus::LoadRaw(std::string directory, std::string type,
+  std::string output_dir) {
+  return Load(directory, type, true, output_dir);
+}
+
+// Reads the documents in the given directory, which have already been
+// parsed, splitting them on the space character.
+bool Corpus::LoadParsed(std::string directory, std::string type) {
+  return Load(directory, type, false, "");
+}
+
+bool Corpus::Load(std::string directory, std::string type, bool raw,
+  std::string output_dir) {
+
+  documents.clear();
+
+  // List the directory once, mapping every index to a document.
+  if ( index.Load(directory, type) == false ) {
+    return false;
+  }
+
+  documents.resize(index.Size());
+
+  // Whether every document was read (and written) successfully. Every
+  // worker only touches the cells of its own documents.
+  std::vector<char> succeeded(index.Size(), 0);
+
+  // The parsed documents are written by a background thread, so the
+  // workers never wait for the disk.
+  OutputWriter writer(output_dir != "");
+
+  // The queue holds a few tasks per worker, so the workers never
+  // run out of documents while they are being submitted.
+  ThreadPool pool(threads, 4 * threads);
+
+  // Read the documents from the directory in ascending order,
+  // starting from the document corresponding to the index 0.
+  for ( size_t doc = 0; doc < index.Size(); doc++ ) {
+
+    pool.Submit([this, doc, raw, output_dir, &succeeded, &writer] {
+      succeeded[doc] = ReadDocument(doc, raw, output_dir, writer);
+    });
+
+    // Have a counter notifying the user about the progress.
+    if ( doc % 10 == 0) {
+      std::cout << "\r\t" << doc;
+      fflush(stdout);
+    }
+  }
+
+  pool.Wait();
+
+  if ( writer.Finish() == false ) {
+    return false;
+  }
+
+  for ( size_t doc = 0; doc < index.Size(); doc++ ) {
+    if ( succeeded[doc] == false ) {
+      return false;
+    }
+  }
+
+  std::cout << '\r' << "\tParsed " << index.Size() << " files from ";
+  std::cout << directory << std::endl;
+
+  return true;
+}
+
+// Reads a single document, storing the IDs of its words in the documents
+// vector. If an output directory is given, the words are also written in
+// a document with the same name.
+bool Corpus::ReadDocument(size_t doc, bool raw, std::string output_dir,
+  OutputWriter &writer) {
+
+  // Map the document in memory. The words are views of the mapped text,
+  // so nothing is copied until a new word is added in the vocabulary.
+  MappedFile input_file;
+  if ( input_file.Open(index.GetPath(doc)) == false ) {
+    std::cout << "\nError: Could not open input file ";
+    std::cout << index.GetPath(doc) << std::endl;
+    return false;
+  }
+
+  // Word vector will be storing every word from the input document.
+  std::vector<std::string_view> word_vector;
+
+  if ( raw == true ) {
+    TokenizeRaw(input_file.Data(), input_file.Size(), word_vector);
+  }
+  else {
+    TokenizeParsed(input_file.GetText(), word_vector);
+  }
+
+  if ( output_dir != "" &&
+      WriteDocument(doc, word_vector, output_dir, writer) == false ) {
+    return false;
+  }
+
+  vocabulary.Intern(word_vector, documents.at(doc));
+
+  return true;
+}
+
+// Writes the words of a document on a document with the same name
+// in the output directory, seperated by a space. The words are gathered
+// in a single buffer, which the writer writes in one go.
+bool Corpus::WriteDocument(size_t doc,
+  const std::vector<std::string_view> &word_vector,
+  std::string output_dir, OutputWriter &writer) const {
+
+  size_t length = word_vector.size();
+  for ( size_t i = 0; i < word_vector.size(); i++ ) {
+    length += word_vector[i].size();
+  }
+
+  std::string buffer;
+  buffer.reserve(length);
+  for ( size_t i = 0; i < word_vector.size(); i++ ) {
+    buffer += word_vector[i];
+    if ( i < word_vector.size() - 1 ) {
+      buffer += ' ';
+    }
+  }
+
+  return writer.Write(output_dir + index.GetFile(doc), std::move(buffer),
+      false);
+}
+
+size_t Corpus::Size() const {
+  return documents.size();
+}
+
+std::string Corpus::GetDirectory() const {
+  return index.GetDirectory();
+}
+
+std::string Corpus::GetFile(size_t doc) const {
+  return index.GetFile(doc);
+}
+
+const std::vector<WordId> &Corpus::GetWords(size_t doc) const {
+  return documents.at(doc);
+}
+
+const Vocabulary &Corpus::GetVocabulary() const {
+  return vocabulary;
+}
@@ -0,0 +1,60 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "corpusindex.h"
+#include "outputwriter.h"
+#include "vocabulary.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Holds the words of every document of a directory in memory, so the
+// training and classification stages can use them directly. The words
+// can either be produced from the raw documents, by removing any common
+// words, punctuation, and making everything lowercase, or be read from
+// the previously parsed documents. Writing the parsed documents on the
+// disk is optional and only useful for debugging, and is left to the
+// background thread of an output writer. The documents are
+// read, parsed and written by a pool of worker threads, and every
+// document is handled on its own, so the result does not depend on the
+// number of threads. The words are kept as IDs of the shared vocabulary.
+class Corpus {
+public:
+  Corpus(size_t threads, Vocabulary &vocabulary);
+  ~Corpus();
+
+  bool LoadRaw(std::string directory, std::string type,
+      std::string output_dir);
+  bool LoadParsed(std::string directory, std::string type);
+
+  size_t Size() const;
+  std::string GetDirectory() const;
+  std::string GetFile(size_t index) const;
+  const std::vector<WordId> &GetWords(size_t index) const;
+  const Vocabulary &GetVocabulary() const;
+
+private:
+  bool Load(std::string directory, std::string type, bool raw,
+      std::string output_dir);
+  bool ReadDocument(size_t doc, bool raw, std::string output_dir,
+      OutputWriter &writer);
+  bool WriteDocument(size_t doc, const std::vector<std::string_view> &words,
+      std::string output_dir, OutputWriter &writer) const;
+
+  // The number of threads used to load the documents.
+  size_t threads;
+
+  // The vocabulary giving an ID to every word.
+  Vocabulary &vocabulary;
+
+  // The index of the directory the documents were read from.
+  CorpusIndex index;
+
+  // The IDs of the words of every document, sorted by the document's
+  // index. Words from different lines of a document are separated by an
+  // empty word, so that no term is created across the lines.
+  std::vector<std::vector<WordId>> documents;
+};
+
+#endif
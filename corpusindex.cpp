@@ -0,0 +1,136 @@
+#include "corpusindex.h"
+
+#include <dirent.h>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+CorpusIndex::CorpusIndex() {}
+
+CorpusIndex::~CorpusIndex() {}
+
+// Reads every entry of the directory once, parses the index out of every
+// document name and stores the names in a table sorted by index.
+bool CorpusIndex::Load(std::string dir, std::string dir_type) {
+
+  directory = dir;
+  type = dir_type;
+  files.clear();
+
+  if ( type != "train" && type != "test" ) {
+    std::cout << "\tError: Wrong directory type: " << type << std::endl;
+    return false;
+  }
+
+  // Every document found, along with its index.
+  std::vector<std::pair<size_t, std::string>> entries;
+
+  DIR *dirp;
+  struct dirent *ent;
+
+  // Open a directory stream pointing to the directory where the
+  // documents are located.
+  dirp = opendir(directory.c_str());
+
+  // If there are no errors, a pointer to the directory is returned.
+  // Else, NULL is returned.
+  if ( dirp == NULL ) {
+    std::cout << "\tError: Could not open directory ";
+    std::cout << directory << std::endl;
+    return false;
+  }
+
+  // Get the next directory entry in the stream.
+  // NULL is returned when reaching the end.
+  while ( (ent = readdir(dirp)) != NULL ) {
+
+    // Get the name of the current document.
+    std::string file_name = ent->d_name;
+
+    // Exclude the . and .. directories, along with any file
+    // that does not follow the naming of the directory type.
+    size_t index;
+    if ( file_name != "." && file_name != ".." &&
+        ParseIndex(file_name, index) == true ) {
+      entries.push_back(std::make_pair(index, file_name));
+    }
+
+  }
+
+  // Close the directory stream.
+  closedir(dirp);
+
+  std::sort(entries.begin(), entries.end());
+
+  // Keep the documents with the indices 0, 1, 2, ... up to the first
+  // index that is missing. If two documents share an index, keep the
+  // first one.
+  for ( size_t i = 0; i < entries.size(); i++ ) {
+    if ( entries.at(i).first == files.size() ) {
+      files.push_back(entries.at(i).second);
+    }
+    else if ( entries.at(i).first > files.size() ) {
+      std::cout << "\tWarning: Document with index " << files.size();
+      std::cout << " is missing from " << directory << ". Ignoring ";
+      std::cout << entries.size() - i << " documents." << std::endl;
+      break;
+    }
+  }
+
+  return true;
+}
+
+size_t CorpusIndex::Size() const {
+  return files.size();
+}
+
+std::string CorpusIndex::GetFile(size_t index) const {
+  return files.at(index);
+}
+
+std::string CorpusIndex::GetPath(size_t index) const {
+  return directory + files.at(index);
+}
+
+std::string CorpusIndex::GetDirectory() const {
+  return directory;
+}
+
+// Gets the name of a document and returns the index it corresponds to.
+// For example, "2_R.txt" and "00002.txt" both correspond to the index 2,
+// depending on the type of directory (training or testing).
+bool CorpusIndex::ParseIndex(std::string file_name, size_t &index) {
+
+  // Count the leading digits of the name.
+  size_t digits = 0;
+  while ( digits < file_name.length() &&
+      file_name[digits] >= '0' && file_name[digits] <= '9' ) {
+    digits++;
+  }
+
+  if ( digits == 0 || digits > 9 ) {
+    return false;
+  }
+
+  index = std::stoul(file_name.substr(0, digits));
+
+  if ( type == "train" ) {
+    // The index is followed by an underscore and it has no leading zeroes.
+    if ( file_name.substr(digits, 1) != "_" ||
+        file_name.substr(0, digits) != std::to_string(index) ) {
+      return false;
+    }
+  }
+  else {
+    // The index is zero padded to 5 digits and followed by the extension.
+    std::string padded = std::to_string(index);
+    if ( padded.length() < 5 ) {
+      padded = std::string(5 - padded.length(), '0') + padded;
+    }
+    if ( file_name != padded + ".txt" ) {
+      return false;
+    }
+  }
+
+  return true;
+}
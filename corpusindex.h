@@ -0,0 +1,35 @@
+#ifndef CORPUSINDEX_H
+#define CORPUSINDEX_H
+
+#include <string>
+#include <vector>
+
+// Lists a document directory once and keeps a table mapping the index of
+// every document to its file name. Training documents are named "N_R.txt"
+// (index N, rating R) and testing documents are named "NNNNN.txt" (the
+// index, zero padded to 5 digits). The table only covers the indices
+// 0, 1, 2, ... up to the first missing one, which is the same set of
+// documents that the old per-index directory scan would visit.
+class CorpusIndex {
+public:
+  CorpusIndex();
+  ~CorpusIndex();
+
+  bool Load(std::string directory, std::string type);
+
+  size_t Size() const;
+  std::string GetFile(size_t index) const;
+  std::string GetPath(size_t index) const;
+  std::string GetDirectory() const;
+
+private:
+  bool ParseIndex(std::string file_name, size_t &index);
+
+  std::string directory;
+  std::string type;
+
+  // The file name of every document, sorted by the document's index.
+  std::vector<std::string> files;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "knnbruteforce.h"
+
+KNNBruteForce::KNNBruteForce() {}
+
+KNNBruteForce::~KNNBruteForce() {}
+
+bool KNNBruteForce::Build(const KNNTrainingSet &training_set) {
+  training = &training_set;
+  return true;
+}
+
+// Parse all the positive documents and then all the negative documents,
+// keeping the top k similarities.
+void KNNBruteForce::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  results.clear();
+  SearchRange(test, k, 0, training->Size(), results);
+}
+
+bool KNNBruteForce::CanSplit() const {
+  return true;
+}
+
+void KNNBruteForce::SearchRange(const TermWeights &test, size_t k,
+  size_t first, size_t last, std::vector<KNNResult> &results) const {
+
+  thread_local std::vector<uint32_t> term_ids;
+  thread_local std::vector<float> weights;
+  SplitTermWeights(test, term_ids, weights);
+
+  float norm_test = GetNorm(test);
+
+  for ( size_t doc = first; doc < last; doc++ ) {
+    AddTopK(results, k, doc, CosSimResult(term_ids.data(), weights.data(),
+          test.size(), norm_test, doc));
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef KNNBRUTEFORCE_H
+#define KNNBRUTEFORCE_H
+
+#include "knnsearch.h"
+
+// Calculates the similarity between the testing document and every
+// training document. Slow, but used as the reference for the results
+// of the other searches.
+class KNNBruteForce : public KNNSearch {
+public:
+  KNNBruteForce();
+  ~KNNBruteForce();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  bool CanSplit() const;
+  void SearchRange(const TermWeights &test, size_t k, size_t first,
+      size_t last, std::vector<KNNResult> &results) const;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "knnindex.h"
+
+#include <algorithm>
+
+KNNIndex::KNNIndex() {}
+
+KNNIndex::~KNNIndex() {}
+
+// Adds the terms of every training document in the postings of the
+// terms. The documents are added in ascending order, so the postings of
+// every term are sorted by document.
+bool KNNIndex::Build(const KNNTrainingSet &training_set) {
+
+  training = &training_set;
+
+  size_t docs = training->Size();
+  size_t terms = training->GetTermsSize();
+
+  // Count the postings of every term, and turn them in the offsets.
+  offsets.assign(terms + 1, 0);
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+    const uint32_t *term_ids = training->GetTermIds(doc);
+    for ( size_t i = 0; i < training->GetLength(doc); i++ ) {
+      offsets[term_ids[i] + 1]++;
+    }
+  }
+  for ( size_t t = 0; t < terms; t++ ) {
+    offsets[t + 1] += offsets[t];
+  }
+
+  std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+  posting_docs.resize(offsets.back());
+  posting_weights.resize(offsets.back());
+
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+    const uint32_t *term_ids = training->GetTermIds(doc);
+    const float *weights = training->GetWeights(doc);
+    for ( size_t i = 0; i < training->GetLength(doc); i++ ) {
+      size_t posting = next[term_ids[i]]++;
+      posting_docs[posting] = doc;
+      posting_weights[posting] = weights[i];
+    }
+  }
+
+  return true;
+}
+
+void KNNIndex::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  if ( test.size() == 0 ) {
+    SearchEmpty(k, results);
+    return;
+  }
+  results.clear();
+
+  SearchRange(test, k, 0, training->Size(), results);
+
+  FillTopK(k, GetNorm(test), results);
+}
+
+bool KNNIndex::CanSplit() const {
+  return true;
+}
+
+// The first posting of a term with a document from first onwards.
+size_t KNNIndex::FirstPosting(size_t term, size_t first) const {
+  const uint32_t *begin = posting_docs.data() + offsets[term];
+  const uint32_t *end = posting_docs.data() + offsets[term + 1];
+  return offsets[term] + (std::lower_bound(begin, end, first) - begin);
+}
+
+void KNNIndex::SearchRange(const TermWeights &test, size_t k, size_t first,
+  size_t last, std::vector<KNNResult> &results) const {
+
+  // The dot products of the training documents, and the documents with
+  // at least one common term. Kept by every thread between its searches,
+  // and cleared after every search.
+  thread_local std::vector<float> noms;
+  thread_local std::vector<uint32_t> touched;
+  noms.resize(training->Size(), 0);
+
+  // Walk the postings of the terms in the order of the terms, so the dot
+  // product of every document is added up in the same order as the
+  // brute force search.
+  for ( auto it_term : test ) {
+    float weight = it_term.second;
+
+    for ( size_t p = FirstPosting(it_term.first, first);
+        p < offsets[it_term.first + 1] && posting_docs[p] < last; p++ ) {
+      uint32_t doc = posting_docs[p];
+
+      // A document is only touched more than once if its dot product
+      // stays 0, so it is never added twice in the top k.
+      if ( noms[doc] == 0 ) {
+        touched.push_back(doc);
+      }
+      noms[doc] += weight * posting_weights[p];
+    }
+  }
+
+  float norm_test = GetNorm(test);
+
+  // Only the touched documents can have a similarity above 0.
+  for ( size_t i = 0; i < touched.size(); i++ ) {
+    size_t doc = touched[i];
+    float similarity = Similarity(doc, noms[doc], norm_test);
+    if ( similarity > 0 ) {
+      AddTopK(results, k, doc, similarity);
+    }
+  }
+
+  for ( size_t i = 0; i < touched.size(); i++ ) {
+    noms[touched[i]] = 0;
+  }
+  touched.clear();
+}
+
+// The dot products of a batch are kept for a block of training documents
+// at a time, one row per testing document, in at most this many floats,
+// so the block stays in the cache while the postings are walked.
+const size_t batch_block_floats = 64 * 1024;
+
+// A term of a testing document of a batch.
+struct BatchTerm {
+  uint32_t term;
+  uint32_t test;
+  float weight;
+};
+
+// Multiplies the batch of testing vectors with the training vectors, a
+// block of training documents at a time. The terms of the whole batch are
+// sorted by term, so the postings of a term are walked by every testing
+// document that has the term while they are still in the cache. The dot
+// products of every testing document are still added up in the order of
+// its terms, giving the same similarities as searching it alone.
+void KNNIndex::SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+  std::vector<std::vector<KNNResult>> &results) const {
+
+  results.resize(tests.size());
+
+  std::vector<BatchTerm> batch_terms;
+  for ( size_t q = 0; q < tests.size(); q++ ) {
+    if ( tests[q].size() == 0 ) {
+      SearchEmpty(k, results[q]);
+      continue;
+    }
+    results[q].clear();
+    for ( auto it_term : tests[q] ) {
+      BatchTerm batch_term;
+      batch_term.term = it_term.first;
+      batch_term.test = q;
+      batch_term.weight = it_term.second;
+      batch_terms.push_back(batch_term);
+    }
+  }
+  std::sort(batch_terms.begin(), batch_terms.end(),
+      [](const BatchTerm &a, const BatchTerm &b) {
+        return a.term < b.term || (a.term == b.term && a.test < b.test);
+      });
+
+  // Where every term of the batch goes on in its postings, at the first
+  // document of the current block.
+  std::vector<size_t> cursors(batch_terms.size());
+  for ( size_t e = 0; e < batch_terms.size(); e++ ) {
+    cursors[e] = offsets[batch_terms[e].term];
+  }
+
+  std::vector<float> norms(tests.size());
+  for ( size_t q = 0; q < tests.size(); q++ ) {
+    norms[q] = GetNorm(tests[q]);
+  }
+
+  size_t docs = training->Size();
+  size_t block = std::max<size_t>(1, batch_block_floats /
+      std::max<size_t>(1, tests.size()));
+  std::vector<float> noms(tests.size() * block, 0);
+
+  for ( size_t first = 0; first < docs; first += block ) {
+    size_t last = std::min(first + block, docs);
+
+    for ( size_t e = 0; e < batch_terms.size(); e++ ) {
+      const BatchTerm &batch_term = batch_terms[e];
+      float *row = &noms[batch_term.test * block];
+      size_t end = offsets[batch_term.term + 1];
+      size_t p = cursors[e];
+      for ( ; p < end && posting_docs[p] < last; p++ ) {
+        row[posting_docs[p] - first] +=
+            batch_term.weight * posting_weights[p];
+      }
+      cursors[e] = p;
+    }
+
+    // Only the documents with a dot product other than 0 can have a
+    // similarity above 0.
+    for ( size_t q = 0; q < tests.size(); q++ ) {
+      if ( tests[q].size() == 0 ) {
+        continue;
+      }
+      float *row = &noms[q * block];
+      for ( size_t doc = first; doc < last; doc++ ) {
+        float nom = row[doc - first];
+        if ( nom != 0 ) {
+          float similarity = Similarity(doc, nom, norms[q]);
+          if ( similarity > 0 ) {
+            AddTopK(results[q], k, doc, similarity);
+          }
+          row[doc - first] = 0;
+        }
+      }
+    }
+  }
+
+  for ( size_t q = 0; q < tests.size(); q++ ) {
+    if ( tests[q].size() != 0 ) {
+      FillTopK(k, norms[q], results[q]);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef KNNINDEX_H
+#define KNNINDEX_H
+
+#include "knnsearch.h"
+
+#include <stdint.h>
+
+// An inverted index of the training documents. For every term, it keeps
+// the documents the term is found in, along with the weight of the term
+// in each document. A search only adds up the similarities of the
+// documents that share at least one term with the testing document, and
+// finds exactly the same top k as the brute force search. A batch of
+// testing documents is searched together, walking the postings of every
+// term once for all the documents of the batch that have the term. The
+// postings are sorted by document, so a range of the training documents is
+// searched from the first posting of every term inside the range.
+class KNNIndex : public KNNSearch {
+public:
+  KNNIndex();
+  ~KNNIndex();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  void SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+      std::vector<std::vector<KNNResult>> &results) const;
+  bool CanSplit() const;
+  void SearchRange(const TermWeights &test, size_t k, size_t first,
+      size_t last, std::vector<KNNResult> &results) const;
+
+protected:
+  size_t FirstPosting(size_t term, size_t first) const;
+
+  // The postings of the term with order t are found between the
+  // offsets[t] and offsets[t + 1] of the posting_docs and the
+  // posting_weights, sorted by document.
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> posting_docs;
+  std::vector<float> posting_weights;
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "knnivf.h"
+
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <math.h>
+
+// The number of k-means iterations, and the seed picking the first
+// centroids, fixed so every run builds the same clusters.
+const size_t ivf_iterations = 10;
+const unsigned ivf_seed = 42;
+
+KNNIvf::KNNIvf(size_t num_clusters, size_t num_probes) {
+  clusters = num_clusters;
+  nprobe = num_probes > 0 ? num_probes : 1;
+}
+
+KNNIvf::~KNNIvf() {}
+
+bool KNNIvf::Build(const KNNTrainingSet &training_set) {
+
+  training = &training_set;
+  size_t docs = training->Size();
+
+  // Without training documents there is nothing to cluster, and every
+  // search finds nothing.
+  if ( docs == 0 ) {
+    clusters = 0;
+    centroid_offsets.assign(1, 0);
+    centroid_terms.clear();
+    centroid_weights.clear();
+    IndexCentroids();
+    cluster_docs.clear();
+    return true;
+  }
+
+  // Without a number of clusters, use the square root of the documents,
+  // so the clusters and the documents of a cluster grow alike.
+  if ( clusters == 0 ) {
+    clusters = sqrt(static_cast<double>(docs));
+  }
+  clusters = std::max<size_t>(1, std::min(clusters, docs));
+
+  // Start from the vectors of randomly picked documents.
+  std::vector<uint32_t> seeds(docs);
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+    seeds[doc] = doc;
+  }
+  std::mt19937 generator(ivf_seed);
+  std::shuffle(seeds.begin(), seeds.end(), generator);
+
+  std::vector<uint32_t> assignments(docs, clusters);
+  for ( size_t c = 0; c < clusters; c++ ) {
+    assignments[seeds[c]] = c;
+  }
+  UpdateCentroids(assignments);
+
+  for ( size_t iteration = 0; iteration < ivf_iterations; iteration++ ) {
+    std::vector<uint32_t> previous = assignments;
+    AssignDocuments(assignments);
+    if ( assignments == previous ) {
+      break;
+    }
+    UpdateCentroids(assignments);
+  }
+
+  cluster_docs.assign(clusters, std::vector<uint32_t>());
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+    cluster_docs[assignments[doc]].push_back(doc);
+  }
+
+  std::cout << "\tGrouped " << docs << " documents in " << clusters;
+  std::cout << " clusters, searching " << std::min(nprobe, clusters);
+  std::cout << " of them." << std::endl;
+
+  return true;
+}
+
+bool KNNIvf::IsExact() const {
+  return nprobe >= clusters;
+}
+
+// Calculates the dot product of a vector with every centroid, using the
+// postings of the terms of the centroids.
+void KNNIvf::ScoreCentroids(const uint32_t *term_ids, const float *weights,
+  size_t length, std::vector<float> &scores) const {
+
+  scores.assign(clusters, 0);
+  for ( size_t i = 0; i < length; i++ ) {
+    uint32_t term = term_ids[i];
+    for ( size_t p = term_offsets[term]; p < term_offsets[term + 1]; p++ ) {
+      scores[term_clusters[p]] += weights[i] * term_weights[p];
+    }
+  }
+}
+
+// Moves every document to the cluster with the most similar centroid.
+// The norm of the document does not change which cluster that is.
+void KNNIvf::AssignDocuments(std::vector<uint32_t> &assignments) const {
+
+  std::vector<float> scores;
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    ScoreCentroids(training->GetTermIds(doc), training->GetWeights(doc),
+        training->GetLength(doc), scores);
+
+    size_t best = 0;
+    for ( size_t c = 1; c < clusters; c++ ) {
+      if ( scores[c] > scores[best] ) {
+        best = c;
+      }
+    }
+
+    // A document with no common term with any centroid stays where it is.
+    if ( scores[best] > 0 || assignments[doc] >= clusters ) {
+      assignments[doc] = best;
+    }
+  }
+}
+
+// Sets every centroid to the mean of the unit vectors of its documents,
+// made a unit vector itself. A cluster left with no documents keeps its
+// centroid. Documents not assigned to a cluster yet are skipped.
+void KNNIvf::UpdateCentroids(const std::vector<uint32_t> &assignments) {
+
+  std::vector<std::vector<uint32_t>> members(clusters);
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    if ( assignments[doc] < clusters ) {
+      members[assignments[doc]].push_back(doc);
+    }
+  }
+
+  std::vector<size_t> offsets(1, 0);
+  std::vector<uint32_t> terms;
+  std::vector<float> weights;
+
+  std::vector<float> sums(training->GetTermsSize(), 0);
+  std::vector<uint32_t> touched;
+
+  for ( size_t c = 0; c < clusters; c++ ) {
+
+    if ( members[c].empty() == true && centroid_offsets.size() > c + 1 ) {
+      for ( size_t p = centroid_offsets[c]; p < centroid_offsets[c + 1];
+          p++ ) {
+        terms.push_back(centroid_terms[p]);
+        weights.push_back(centroid_weights[p]);
+      }
+      offsets.push_back(terms.size());
+      continue;
+    }
+
+    for ( auto doc : members[c] ) {
+      float norm = training->GetNorm(doc);
+      if ( norm == 0 ) {
+        continue;
+      }
+      const uint32_t *term_ids = training->GetTermIds(doc);
+      const float *doc_weights = training->GetWeights(doc);
+      for ( size_t i = 0; i < training->GetLength(doc); i++ ) {
+        if ( sums[term_ids[i]] == 0 ) {
+          touched.push_back(term_ids[i]);
+        }
+        sums[term_ids[i]] += doc_weights[i] / norm;
+      }
+    }
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()),
+        touched.end());
+
+    double denom = 0;
+    for ( auto term : touched ) {
+      denom += static_cast<double>(sums[term]) * sums[term];
+    }
+    float norm = sqrt(denom);
+
+    for ( auto term : touched ) {
+      if ( sums[term] > 0 ) {
+        terms.push_back(term);
+        weights.push_back(sums[term] / norm);
+      }
+      sums[term] = 0;
+    }
+    touched.clear();
+    offsets.push_back(terms.size());
+  }
+
+  centroid_offsets.swap(offsets);
+  centroid_terms.swap(terms);
+  centroid_weights.swap(weights);
+
+  IndexCentroids();
+}
+
+// Turns the rows of the centroids in the postings of the terms.
+void KNNIvf::IndexCentroids() {
+
+  size_t terms = training->GetTermsSize();
+  term_offsets.assign(terms + 1, 0);
+  for ( size_t p = 0; p < centroid_terms.size(); p++ ) {
+    term_offsets[centroid_terms[p] + 1]++;
+  }
+  for ( size_t t = 0; t < terms; t++ ) {
+    term_offsets[t + 1] += term_offsets[t];
+  }
+
+  std::vector<size_t> next(term_offsets.begin(), term_offsets.end() - 1);
+  term_clusters.resize(centroid_terms.size());
+  term_weights.resize(centroid_terms.size());
+  for ( size_t c = 0; c < clusters; c++ ) {
+    for ( size_t p = centroid_offsets[c]; p < centroid_offsets[c + 1]; p++ ) {
+      size_t posting = next[centroid_terms[p]]++;
+      term_clusters[posting] = c;
+      term_weights[posting] = centroid_weights[p];
+    }
+  }
+}
+
+// Compares the testing document with the documents of the nprobe clusters
+// with the most similar centroids. The rest of the top k, if fewer than k
+// documents with a similarity above 0 were found, are the first documents
+// with a similarity of 0.
+void KNNIvf::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  if ( test.size() == 0 ) {
+    SearchEmpty(k, results);
+    return;
+  }
+  results.clear();
+
+  std::vector<uint32_t> term_ids;
+  std::vector<float> weights;
+  SplitTermWeights(test, term_ids, weights);
+
+  std::vector<float> scores;
+  ScoreCentroids(term_ids.data(), weights.data(), test.size(), scores);
+
+  // Order the clusters by descending similarity, and by ascending cluster
+  // for equal similarities.
+  std::vector<uint32_t> order(clusters);
+  for ( size_t c = 0; c < clusters; c++ ) {
+    order[c] = c;
+  }
+  size_t probes = std::min(nprobe, clusters);
+  std::partial_sort(order.begin(), order.begin() + probes, order.end(),
+      [&scores](uint32_t a, uint32_t b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+      });
+
+  float norm_test = GetNorm(test);
+  for ( size_t i = 0; i < probes; i++ ) {
+    for ( auto doc : cluster_docs[order[i]] ) {
+      float similarity = CosSimResult(term_ids.data(), weights.data(),
+          test.size(), norm_test, doc);
+      if ( similarity > 0 ) {
+        AddTopK(results, k, doc, similarity);
+      }
+    }
+  }
+
+  FillTopK(k, norm_test, results);
+}
@@ -0,0 +1,50 @@
+#ifndef KNNIVF_H
+#define KNNIVF_H
+
+#include "knnsearch.h"
+
+#include <stdint.h>
+
+// An approximate search, using an inverted file of clusters. The training
+// documents are grouped in clusters with spherical k-means, over the same
+// weights used by the other searches. The testing document is only
+// compared with the documents of the nprobe clusters whose centroids are
+// the most similar to it. Searching every cluster gives the same top k as
+// the brute force search.
+class KNNIvf : public KNNSearch {
+public:
+  KNNIvf(size_t clusters, size_t nprobe);
+  ~KNNIvf();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  bool IsExact() const;
+
+private:
+  void AssignDocuments(std::vector<uint32_t> &assignments) const;
+  void UpdateCentroids(const std::vector<uint32_t> &assignments);
+  void IndexCentroids();
+  void ScoreCentroids(const uint32_t *term_ids, const float *weights,
+      size_t length, std::vector<float> &scores) const;
+
+  size_t clusters;
+  size_t nprobe;
+
+  // The centroids, as unit vectors in compressed sparse rows, sorted by
+  // the order of the terms.
+  std::vector<size_t> centroid_offsets;
+  std::vector<uint32_t> centroid_terms;
+  std::vector<float> centroid_weights;
+
+  // The centroids turned around: for every term, the clusters with the
+  // term in their centroid, along with its weight.
+  std::vector<size_t> term_offsets;
+  std::vector<uint32_t> term_clusters;
+  std::vector<float> term_weights;
+
+  // The training documents of every cluster, in ascending order.
+  std::vector<std::vector<uint32_t>> cluster_docs;
+};
+
+#endif
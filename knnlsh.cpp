@@ -0,0 +1,118 @@
+#include "knnlsh.h"
+
+#include <limits>
+
+// The seed of the MinHash functions, fixed so every run finds the same
+// documents.
+const uint64_t lsh_seed = 0x9E3779B97F4A7C15ULL;
+
+KNNLsh::KNNLsh(size_t num_bands, size_t num_rows) {
+  bands = num_bands > 0 ? num_bands : 1;
+  rows = num_rows > 0 ? num_rows : 1;
+}
+
+KNNLsh::~KNNLsh() {}
+
+bool KNNLsh::Build(const KNNTrainingSet &training_set) {
+
+  training = &training_set;
+
+  seeds.resize(bands * rows);
+  for ( size_t i = 0; i < seeds.size(); i++ ) {
+    seeds[i] = MixBits(lsh_seed + i);
+  }
+
+  tables.assign(bands, std::unordered_map<uint64_t, std::vector<uint32_t>>());
+
+  std::vector<uint64_t> keys;
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    GetBandKeys(training->GetTermIds(doc), training->GetLength(doc), keys);
+    for ( size_t band = 0; band < bands; band++ ) {
+      tables[band][keys[band]].push_back(doc);
+    }
+  }
+
+  return true;
+}
+
+bool KNNLsh::IsExact() const {
+  return false;
+}
+
+// Calculates the MinHash signature of a set of terms, and hashes the rows
+// of every band in the key of its bucket.
+void KNNLsh::GetBandKeys(const uint32_t *term_ids, size_t length,
+  std::vector<uint64_t> &keys) const {
+
+  std::vector<uint64_t> signature(seeds.size(),
+      std::numeric_limits<uint64_t>::max());
+  for ( size_t i = 0; i < length; i++ ) {
+    for ( size_t h = 0; h < seeds.size(); h++ ) {
+      uint64_t value = MixBits(term_ids[i] ^ seeds[h]);
+      if ( value < signature[h] ) {
+        signature[h] = value;
+      }
+    }
+  }
+
+  keys.assign(bands, 0);
+  for ( size_t band = 0; band < bands; band++ ) {
+    uint64_t key = band;
+    for ( size_t row = 0; row < rows; row++ ) {
+      key = MixBits(key ^ signature[band * rows + row]);
+    }
+    keys[band] = key;
+  }
+}
+
+// Compares the testing document with every training document sharing a
+// bucket with it, in one of the bands. The rest of the top k, if fewer
+// than k candidates were found, are the first documents with a
+// similarity of 0.
+void KNNLsh::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  if ( test.size() == 0 ) {
+    SearchEmpty(k, results);
+    return;
+  }
+  results.clear();
+
+  std::vector<uint32_t> term_ids;
+  std::vector<float> weights;
+  SplitTermWeights(test, term_ids, weights);
+  std::vector<uint64_t> keys;
+  GetBandKeys(term_ids.data(), term_ids.size(), keys);
+
+  // Whether every training document was already compared. Kept by every
+  // thread between its searches, and cleared after every search.
+  thread_local std::vector<char> compared;
+  thread_local std::vector<uint32_t> candidates;
+  compared.resize(training->Size(), 0);
+
+  for ( size_t band = 0; band < bands; band++ ) {
+    auto found = tables[band].find(keys[band]);
+    if ( found == tables[band].end() ) {
+      continue;
+    }
+    for ( auto doc : found->second ) {
+      if ( compared[doc] == 0 ) {
+        compared[doc] = 1;
+        candidates.push_back(doc);
+      }
+    }
+  }
+
+  float norm_test = GetNorm(test);
+  for ( auto doc : candidates ) {
+    float similarity = CosSimResult(term_ids.data(), weights.data(),
+        test.size(), norm_test, doc);
+    if ( similarity > 0 ) {
+      AddTopK(results, k, doc, similarity);
+    }
+    compared[doc] = 0;
+  }
+  candidates.clear();
+
+  FillTopK(k, norm_test, results);
+}
@@ -0,0 +1,40 @@
+#ifndef KNNLSH_H
+#define KNNLSH_H
+
+#include "knnsearch.h"
+
+#include <unordered_map>
+#include <stdint.h>
+
+// An approximate search, using locality sensitive hashing. Every document
+// gets a MinHash signature over its set of terms, made of bands of rows
+// of MinHash values. Two documents land in the same bucket of a band if
+// all the rows of the band are equal, which is more likely the more terms
+// they share. Only the training documents sharing a bucket with the
+// testing document are compared with it. More bands find more of the
+// nearest documents, and more rows compare fewer documents.
+class KNNLsh : public KNNSearch {
+public:
+  KNNLsh(size_t bands, size_t rows);
+  ~KNNLsh();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  bool IsExact() const;
+
+private:
+  void GetBandKeys(const uint32_t *term_ids, size_t length,
+      std::vector<uint64_t> &keys) const;
+
+  size_t bands;
+  size_t rows;
+
+  // The seed of every MinHash function, bands * rows in total.
+  std::vector<uint64_t> seeds;
+
+  // The training documents in every bucket of every band.
+  std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> tables;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "knnprojection.h"
+
+#include <iostream>
+#include <algorithm>
+#include <immintrin.h>
+#include <math.h>
+
+// The seed of the projection, fixed so every run finds the same
+// documents, and the dimensions every term is projected on. Every term
+// adds its weight to each of its dimensions, with a random sign.
+const uint64_t projection_seed = 0xD1B54A32D192ED03ULL;
+const size_t projection_hashes = 4;
+
+// Every kernel returns the dot product of two rows of dims floats, dims
+// being a multiple of 8. The kernels add the products up in a different
+// order, so their sums may differ in the last bits.
+typedef float (*DotKernel)(const float *a, const float *b, size_t dims);
+
+static float DotScalar(const float *a, const float *b, size_t dims) {
+  float sum = 0;
+  for ( size_t i = 0; i < dims; i++ ) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float DotAVX2(const float *a, const float *b, size_t dims) {
+  __m256 sum = _mm256_setzero_ps();
+  for ( size_t i = 0; i < dims; i += 8 ) {
+    sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i),
+        sum);
+  }
+
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+      _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_movehdup_ps(half));
+  return _mm_cvtss_f32(half);
+}
+
+// Picks the kernel the first time it is needed. A local static is set
+// up once, even by concurrent callers, so a search built while other
+// searches are running never changes the kernel they use.
+static DotKernel GetDotKernel(const char *&name) {
+  static const bool avx2 = __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma");
+  name = avx2 ? "avx2" : "scalar";
+  return avx2 ? DotAVX2 : DotScalar;
+}
+
+KNNProjection::KNNProjection(size_t num_dims, size_t num_candidates) {
+  // Round the dimensions up to a multiple of 8, the floats of an AVX2
+  // register.
+  dims = num_dims > 0 ? (num_dims + 7) / 8 * 8 : 8;
+  candidates = num_candidates > 0 ? num_candidates : 1;
+}
+
+KNNProjection::~KNNProjection() {}
+
+bool KNNProjection::Build(const KNNTrainingSet &training_set) {
+
+  training = &training_set;
+
+  const char *kernel;
+  dot_kernel = GetDotKernel(kernel);
+
+  matrix.assign(training->Size() * dims, 0);
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    Project(training->GetTermIds(doc), training->GetWeights(doc),
+        training->GetLength(doc), &matrix[doc * dims]);
+  }
+
+  std::cout << "\tProjected " << training->Size() << " documents on ";
+  std::cout << dims << " dimensions, scanned with the " << kernel;
+  std::cout << " kernel." << std::endl;
+
+  return true;
+}
+
+bool KNNProjection::IsExact() const {
+  return false;
+}
+
+// Projects the weights of a document on a row, made a unit vector. A
+// document with no terms is left as a row of zeros.
+void KNNProjection::Project(const uint32_t *term_ids, const float *weights,
+  size_t length, float *row) const {
+
+  for ( size_t d = 0; d < dims; d++ ) {
+    row[d] = 0;
+  }
+
+  for ( size_t i = 0; i < length; i++ ) {
+    for ( size_t h = 0; h < projection_hashes; h++ ) {
+      uint64_t value = MixBits(projection_seed ^
+          (static_cast<uint64_t>(term_ids[i]) * projection_hashes + h));
+      size_t d = value % dims;
+      row[d] += (value >> 63) ? -weights[i] : weights[i];
+    }
+  }
+
+  double denom = 0;
+  for ( size_t d = 0; d < dims; d++ ) {
+    denom += static_cast<double>(row[d]) * row[d];
+  }
+  if ( denom > 0 ) {
+    float norm = sqrt(denom);
+    for ( size_t d = 0; d < dims; d++ ) {
+      row[d] /= norm;
+    }
+  }
+}
+
+// Scans every row of the matrix, keeping the candidates with the best
+// projected similarities, and then compares the candidates exactly with
+// the testing document. The rest of the top k, if fewer than k documents
+// with a similarity above 0 were found, are the first documents with a
+// similarity of 0.
+void KNNProjection::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  if ( test.size() == 0 ) {
+    SearchEmpty(k, results);
+    return;
+  }
+  results.clear();
+
+  thread_local std::vector<uint32_t> term_ids;
+  thread_local std::vector<float> weights;
+  thread_local std::vector<float> row;
+  SplitTermWeights(test, term_ids, weights);
+  row.resize(dims);
+  Project(term_ids.data(), weights.data(), test.size(), row.data());
+
+  std::vector<KNNResult> best;
+  size_t scanned = std::max(k, candidates);
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    float projected = dot_kernel(row.data(), &matrix[doc * dims], dims);
+    if ( best.size() < scanned || projected > best.back().similarity ) {
+      AddTopK(best, scanned, doc, projected);
+    }
+  }
+
+  float norm_test = GetNorm(test);
+  for ( auto candidate : best ) {
+    float similarity = CosSimResult(term_ids.data(), weights.data(),
+        test.size(), norm_test, candidate.doc);
+    if ( similarity > 0 ) {
+      AddTopK(results, k, candidate.doc, similarity);
+    }
+  }
+
+  FillTopK(k, norm_test, results);
+}
@@ -0,0 +1,41 @@
+#ifndef KNNPROJECTION_H
+#define KNNPROJECTION_H
+
+#include "knnsearch.h"
+
+#include <stdint.h>
+
+// An approximate search, using dense random projections. Every document
+// is projected on a fixed number of dimensions by a seeded sparse random
+// projection, and made a unit vector, so every training document takes
+// the same memory, in one contiguous matrix. The testing document is
+// projected alike and compared with every row of the matrix, by a SIMD
+// dot product. Only the candidates with the best projected similarities
+// are compared exactly with the testing document.
+class KNNProjection : public KNNSearch {
+public:
+  KNNProjection(size_t dims, size_t candidates);
+  ~KNNProjection();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  bool IsExact() const;
+
+private:
+  void Project(const uint32_t *term_ids, const float *weights,
+      size_t length, float *row) const;
+
+  size_t dims;
+  size_t candidates;
+
+  // The projected training documents, one row of dims floats per
+  // document.
+  std::vector<float> matrix;
+
+  // The kernel comparing the projected rows, picked by Build().
+  float (*dot_kernel)(const float *a, const float *b, size_t dims) =
+      nullptr;
+};
+
+#endif
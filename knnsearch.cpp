@@ -0,0 +1,221 @@
+#include "knnsearch.h"
+#include "knnbruteforce.h"
+#include "knnindex.h"
+#include "knnwand.h"
+#include "knnlsh.h"
+#include "knnivf.h"
+#include "knnprojection.h"
+#include "sparsedot.h"
+
+#include <math.h>
+
+// The finalizer of SplitMix64.
+uint64_t MixBits(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  return value;
+}
+
+float CosineSimilarity(float nom, float norm_test, float norm_train) {
+  return nom / (norm_test * norm_train);
+}
+
+void AddTopK(std::vector<KNNResult> &top_k, size_t k, size_t doc,
+  float similarity) {
+
+  if ( !(similarity == similarity) ) {
+    return;
+  }
+
+  // Find the position of the document, after every document with a
+  // greater similarity, or an equal similarity and a smaller index.
+  size_t i = top_k.size();
+  while ( i > 0 && (similarity > top_k.at(i - 1).similarity ||
+      (similarity == top_k.at(i - 1).similarity &&
+       doc < top_k.at(i - 1).doc)) ) {
+    i--;
+  }
+
+  if ( i >= k ) {
+    return;
+  }
+
+  KNNResult result;
+  result.doc = doc;
+  result.similarity = similarity;
+  top_k.insert(top_k.begin() + i, result);
+  if ( top_k.size() > k ) {
+    top_k.pop_back();
+  }
+}
+
+float GetNorm(const TermWeights &weights) {
+  float denom = 0;
+  for ( auto it_term : weights ) {
+    denom += it_term.second * it_term.second;
+  }
+  return sqrt(denom);
+}
+
+void SplitTermWeights(const TermWeights &test, std::vector<uint32_t> &term_ids,
+  std::vector<float> &weights) {
+
+  term_ids.resize(test.size());
+  weights.resize(test.size());
+  for ( size_t i = 0; i < test.size(); i++ ) {
+    term_ids[i] = test[i].first;
+    weights[i] = test[i].second;
+  }
+}
+
+KNNSearch::~KNNSearch() {}
+
+bool KNNSearch::IsExact() const {
+  return true;
+}
+
+bool KNNSearch::CanSplit() const {
+  return false;
+}
+
+void KNNSearch::SearchRange(const TermWeights &test, size_t k, size_t first,
+  size_t last, std::vector<KNNResult> &results) const {}
+
+// Every range gets about the same number of training documents. The top k
+// of the document is among the top k of the ranges, and AddTopK() orders
+// the documents the same way whatever order they are added in, so merging
+// the ranges gives the same top k as the serial search.
+void KNNSearch::SearchParallel(const TermWeights &test, size_t k,
+  ThreadPool &pool, std::vector<KNNResult> &results) const {
+
+  if ( pool.Size() == 1 || CanSplit() == false || test.size() == 0 ) {
+    Search(test, k, results);
+    return;
+  }
+
+  size_t ranges = pool.Size();
+  size_t docs = training->Size();
+  std::vector<std::vector<KNNResult>> range_results(ranges);
+
+  for ( size_t r = 0; r < ranges; r++ ) {
+    size_t first = r * docs / ranges;
+    size_t last = (r + 1) * docs / ranges;
+    pool.Submit([this, &test, k, first, last, &range_results, r] {
+      SearchRange(test, k, first, last, range_results[r]);
+    });
+  }
+  pool.Wait();
+
+  results.clear();
+  for ( size_t r = 0; r < ranges; r++ ) {
+    for ( size_t i = 0; i < range_results[r].size(); i++ ) {
+      AddTopK(results, k, range_results[r][i].doc,
+          range_results[r][i].similarity);
+    }
+  }
+
+  FillTopK(k, GetNorm(test), results);
+}
+
+void KNNSearch::SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+  std::vector<std::vector<KNNResult>> &results) const {
+
+  results.resize(tests.size());
+  for ( size_t q = 0; q < tests.size(); q++ ) {
+    Search(tests[q], k, results[q]);
+  }
+}
+
+// The similarity of the testing document with a training document,
+// calculated from their vectors. Both vectors are sorted by the order of
+// the terms, so the common terms are found by the SparseDot() kernel.
+float KNNSearch::CosSimResult(const uint32_t *term_ids, const float *weights,
+  size_t length, float norm_test, size_t doc) const {
+
+  size_t train_length = training->GetLength(doc);
+
+  if ( length == 0 && train_length != 0 ) {
+    return 0;
+  }
+  else if ( length != 0 && train_length == 0 ) {
+    return 0;
+  }
+  else if ( length == 0 && train_length == 0 ) {
+    return 1;
+  }
+
+  float nom = SparseDot(term_ids, weights, length,
+      training->GetTermIds(doc), training->GetWeights(doc), train_length);
+
+  return CosineSimilarity(nom, norm_test, training->GetNorm(doc));
+}
+
+// The similarity of a training document, given its dot product with the
+// testing document, which is not empty. Same as the brute force search.
+float KNNSearch::Similarity(size_t doc, float nom, float norm_test) const {
+  if ( training->GetLength(doc) == 0 ) {
+    return 0;
+  }
+  return CosineSimilarity(nom, norm_test, training->GetNorm(doc));
+}
+
+// An empty testing document has a similarity of 1 with the empty
+// training documents, and 0 with the rest.
+void KNNSearch::SearchEmpty(size_t k, std::vector<KNNResult> &results) const {
+  results.clear();
+  for ( size_t doc = 0; doc < training->Size(); doc++ ) {
+    AddTopK(results, k, doc, training->GetLength(doc) == 0 ? 1 : 0);
+  }
+}
+
+// Every document with a similarity above 0 shares a term with the testing
+// document. If fewer than k of them were found, the rest of the top k are
+// the first documents with a similarity of 0, meaning the documents that
+// are not already in the top k and would have a similarity of 0 without
+// any common term.
+void KNNSearch::FillTopK(size_t k, float norm_test,
+  std::vector<KNNResult> &results) const {
+
+  for ( size_t doc = 0; doc < training->Size() && results.size() < k;
+      doc++ ) {
+    if ( Similarity(doc, 0, norm_test) != 0 ) {
+      continue;
+    }
+
+    bool found = false;
+    for ( size_t i = 0; i < results.size(); i++ ) {
+      if ( results[i].doc == doc ) {
+        found = true;
+      }
+    }
+    if ( found == false ) {
+      AddTopK(results, k, doc, 0);
+    }
+  }
+}
+
+KNNSearch *CreateKNNSearch(const KNNOptions &options) {
+  if ( options.search == "brute" ) {
+    return new KNNBruteForce();
+  }
+  else if ( options.search == "index" ) {
+    return new KNNIndex();
+  }
+  else if ( options.search == "wand" ) {
+    return new KNNWand();
+  }
+  else if ( options.search == "lsh" ) {
+    return new KNNLsh(options.lsh_bands, options.lsh_rows);
+  }
+  else if ( options.search == "ivf" ) {
+    return new KNNIvf(options.ivf_clusters, options.ivf_nprobe);
+  }
+  else if ( options.search == "projection" ) {
+    return new KNNProjection(options.projection_dims,
+        options.projection_candidates);
+  }
+  return nullptr;
+}
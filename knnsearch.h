@@ -0,0 +1,125 @@
+#ifndef KNNSEARCH_H
+#define KNNSEARCH_H
+
+#include "knntrainingset.h"
+#include "threadpool.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// The weights of the terms of a document, along with the order of every
+// term, sorted by the order of the terms.
+typedef std::vector<std::pair<size_t, float>> TermWeights;
+
+// A training document found by a search, along with its similarity to the
+// testing document. The positive documents are numbered first, followed
+// by the negative documents.
+struct KNNResult {
+  size_t doc;
+  float similarity;
+};
+
+// Mixes the bits of a 64-bit value, giving a different hash function for
+// every seed it is combined with. Used by the searches hashing the terms.
+uint64_t MixBits(uint64_t value);
+
+// Every dot product and sum of squared weights is added up in the order of
+// the terms, and turned in a cosine similarity by this function, so every
+// search finds exactly the same similarities.
+float CosineSimilarity(float nom, float norm_test, float norm_train);
+
+// The square root of the sum of the squared weights of a document.
+float GetNorm(const TermWeights &weights);
+
+// Adds a document in the top k results, sorted by descending similarity,
+// and by ascending document for equal similarities. A similarity that is
+// not a number is never added.
+void AddTopK(std::vector<KNNResult> &top_k, size_t k, size_t doc,
+    float similarity);
+
+// Splits the vector of a testing document in the orders of its terms and
+// their weights, the layout of the training vectors.
+void SplitTermWeights(const TermWeights &test, std::vector<uint32_t> &term_ids,
+    std::vector<float> &weights);
+
+// The search used by the knn method, and the settings of the searches.
+// The lsh search hashes every document in bands of rows of MinHash values.
+// The ivf search groups the documents in ivf_clusters clusters (0 for the
+// square root of the documents), and searches the ivf_nprobe nearest.
+// The projection search projects every document on projection_dims
+// dimensions, and compares projection_candidates documents exactly.
+// The testing documents are searched in batches of batch_size documents,
+// or one at a time split over search_threads threads when there are more
+// than one.
+// The searches that are not exact report their recall against the brute
+// force search, over a sample of recall_docs testing documents.
+struct KNNOptions {
+  std::string search = "index";
+  size_t lsh_bands = 64;
+  size_t lsh_rows = 1;
+  size_t ivf_clusters = 0;
+  size_t ivf_nprobe = 4;
+  size_t projection_dims = 256;
+  size_t projection_candidates = 100;
+  size_t batch_size = 32;
+  size_t search_threads = 1;
+  size_t recall_docs = 100;
+};
+
+// The ways the k nearest training documents of a testing document can be
+// found. Every search is built once over the training set, which must
+// outlive it, and can then be searched by many threads at the same time.
+class KNNSearch {
+public:
+  virtual ~KNNSearch();
+
+  virtual bool Build(const KNNTrainingSet &training_set) = 0;
+  virtual void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const = 0;
+
+  // Finds the top k of every testing document of a batch, the same top k
+  // as searching them one at a time. Searches that can share the walk of
+  // the training documents between the documents of a batch override it.
+  virtual void SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+      std::vector<std::vector<KNNResult>> &results) const;
+
+  // Finds the top k of a testing document, with the training documents
+  // split in ranges searched by the threads of the pool. Every thread
+  // keeps the top k of its range, and the ranges are merged in the same
+  // top k as searching the document on one thread. Searches that can not
+  // be split are searched on the calling thread.
+  void SearchParallel(const TermWeights &test, size_t k, ThreadPool &pool,
+      std::vector<KNNResult> &results) const;
+
+  // Whether the search always finds the same top k as the brute force
+  // search.
+  virtual bool IsExact() const;
+
+  // Whether the search can find the top k of a range of the training
+  // documents, with SearchRange().
+  virtual bool CanSplit() const;
+
+  // Adds in the results the documents between first and last that are in
+  // their top k, leaving out the documents with a similarity of 0 if the
+  // search skips them. Used by the searches that can be split.
+  virtual void SearchRange(const TermWeights &test, size_t k, size_t first,
+      size_t last, std::vector<KNNResult> &results) const;
+
+protected:
+  float CosSimResult(const uint32_t *term_ids, const float *weights,
+      size_t length, float norm_test, size_t doc) const;
+  float Similarity(size_t doc, float nom, float norm_test) const;
+  void SearchEmpty(size_t k, std::vector<KNNResult> &results) const;
+  void FillTopK(size_t k, float norm_test,
+      std::vector<KNNResult> &results) const;
+
+  const KNNTrainingSet *training = nullptr;
+};
+
+// Creates the search named in the options, or returns nullptr if there
+// is no such search.
+KNNSearch *CreateKNNSearch(const KNNOptions &options);
+
+#endif
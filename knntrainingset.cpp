@@ -0,0 +1,173 @@
+#include "knntrainingset.h"
+
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+
+KNNTrainingSet::KNNTrainingSet()
+    : pos_docs(0), docs(0), terms(0), postings(0), offsets(nullptr),
+      term_ids(nullptr), weights(nullptr), norms(nullptr) {}
+
+KNNTrainingSet::~KNNTrainingSet() {}
+
+bool KNNTrainingSet::Build(const TrainingStats &stats) {
+
+  const auto &term_set = stats.GetTermSet();
+  const auto &good_docs_terms = stats.GetGoodDocsTerms();
+  const auto &bad_docs_terms = stats.GetBadDocsTerms();
+
+  pos_docs = good_docs_terms.size();
+  docs = pos_docs + bad_docs_terms.size();
+  terms = term_set.size();
+
+  built_offsets.assign(1, 0);
+  built_offsets.reserve(docs + 1);
+  built_term_ids.clear();
+  built_weights.clear();
+  built_norms.clear();
+  built_norms.reserve(docs);
+
+  // The terms of a single document, along with their weights, before
+  // they are sorted.
+  std::vector<std::pair<uint32_t, float>> doc_weights;
+
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+
+    bool positive = doc < pos_docs;
+    const auto &class_terms =
+        positive ? stats.GetGoodTerms() : stats.GetBadTerms();
+    const auto &doc_terms = positive ? good_docs_terms.at(doc) :
+        bad_docs_terms.at(doc - pos_docs);
+
+    // For every term in the document, get the weight of the term,
+    // and add it to the vector.
+    doc_weights.clear();
+    for ( auto term : doc_terms ) {
+      auto found_class = class_terms.find(term);
+      if ( found_class == class_terms.end() ) {
+        std::cout << "\tError: Could not find term ";
+        std::cout << stats.GetVocabulary().GetTerm(term) << " in the ";
+        std::cout << (positive ? "good_terms" : "bad_terms");
+        std::cout << " map." << std::endl;
+        return false;
+      }
+      uint32_t order = term_set.at(term).order;
+      doc_weights.push_back(
+          std::make_pair(order, found_class->second.weight));
+    }
+
+    std::sort(doc_weights.begin(), doc_weights.end());
+
+    float denom = 0;
+    for ( auto it_term : doc_weights ) {
+      built_term_ids.push_back(it_term.first);
+      built_weights.push_back(it_term.second);
+      denom += it_term.second * it_term.second;
+    }
+    built_offsets.push_back(built_term_ids.size());
+    built_norms.push_back(sqrt(denom));
+  }
+
+  // Release the memory reserved while the vectors were growing.
+  std::vector<uint32_t>(built_term_ids).swap(built_term_ids);
+  std::vector<float>(built_weights).swap(built_weights);
+
+  postings = built_term_ids.size();
+  offsets = built_offsets.data();
+  term_ids = built_term_ids.data();
+  weights = built_weights.data();
+  norms = built_norms.data();
+
+  return true;
+}
+
+void KNNTrainingSet::Save(ModelWriter &writer) const {
+  writer.Write<uint64_t>(pos_docs);
+  writer.Write<uint64_t>(terms);
+  writer.WriteArray(offsets, docs + 1);
+  writer.WriteArray(term_ids, postings);
+  writer.WriteArray(weights, postings);
+  writer.WriteArray(norms, docs);
+}
+
+// Uses the vectors written by Save() in place, checking that the offsets
+// and the term IDs stay inside the arrays, so a damaged file is refused
+// instead of being searched.
+bool KNNTrainingSet::Load(ModelReader &reader) {
+
+  uint64_t file_pos_docs = 0, file_terms = 0;
+  size_t offsets_size = 0, term_ids_size = 0, weights_size = 0;
+  if ( reader.Read(file_pos_docs) == false ||
+      reader.Read(file_terms) == false ||
+      reader.ReadArray(offsets, offsets_size) == false ||
+      reader.ReadArray(term_ids, term_ids_size) == false ||
+      reader.ReadArray(weights, weights_size) == false ||
+      reader.ReadArray(norms, docs) == false ) {
+    return false;
+  }
+
+  pos_docs = file_pos_docs;
+  terms = file_terms;
+  postings = term_ids_size;
+
+  if ( offsets_size != docs + 1 || pos_docs > docs || offsets[0] != 0 ||
+      offsets[docs] != postings || weights_size != postings ) {
+    return false;
+  }
+  for ( size_t doc = 0; doc < docs; doc++ ) {
+    if ( offsets[doc] > offsets[doc + 1] ) {
+      return false;
+    }
+  }
+  for ( size_t i = 0; i < postings; i++ ) {
+    if ( term_ids[i] >= terms ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Drops every vector, leaving a set of no documents and no terms.
+void KNNTrainingSet::Clear() {
+  pos_docs = 0;
+  docs = 0;
+  terms = 0;
+  postings = 0;
+  offsets = nullptr;
+  term_ids = nullptr;
+  weights = nullptr;
+  norms = nullptr;
+  built_offsets.clear();
+  built_term_ids.clear();
+  built_weights.clear();
+  built_norms.clear();
+}
+
+size_t KNNTrainingSet::Size() const {
+  return docs;
+}
+
+size_t KNNTrainingSet::GetTermsSize() const {
+  return terms;
+}
+
+bool KNNTrainingSet::IsPositive(size_t doc) const {
+  return doc < pos_docs;
+}
+
+size_t KNNTrainingSet::GetLength(size_t doc) const {
+  return offsets[doc + 1] - offsets[doc];
+}
+
+const uint32_t *KNNTrainingSet::GetTermIds(size_t doc) const {
+  return term_ids + offsets[doc];
+}
+
+const float *KNNTrainingSet::GetWeights(size_t doc) const {
+  return weights + offsets[doc];
+}
+
+float KNNTrainingSet::GetNorm(size_t doc) const {
+  return norms[doc];
+}
@@ -0,0 +1,66 @@
+#ifndef KNNTRAININGSET_H
+#define KNNTRAININGSET_H
+
+#include "trainingstats.h"
+#include "modelfile.h"
+
+#include <vector>
+#include <stdint.h>
+
+// The vectors of the training documents used by the knn searches, stored
+// in compressed sparse rows. The terms of the document doc are found
+// between the offsets[doc] and offsets[doc + 1] of the term_ids and the
+// weights, sorted by the order of the terms. The positive documents are
+// numbered first, followed by the negative documents. A term of a positive
+// (negative) document has the weight of the term in the good(bad)_terms.
+// The arrays are either built from the training statistics, or used in
+// place in a model file mapped by a ModelReader, which must outlive them.
+class KNNTrainingSet {
+public:
+  KNNTrainingSet();
+  ~KNNTrainingSet();
+
+  KNNTrainingSet(const KNNTrainingSet &) = delete;
+  KNNTrainingSet &operator=(const KNNTrainingSet &) = delete;
+
+  bool Build(const TrainingStats &stats);
+  void Save(ModelWriter &writer) const;
+  bool Load(ModelReader &reader);
+  void Clear();
+
+  size_t Size() const;
+  size_t GetTermsSize() const;
+  bool IsPositive(size_t doc) const;
+
+  size_t GetLength(size_t doc) const;
+  const uint32_t *GetTermIds(size_t doc) const;
+  const float *GetWeights(size_t doc) const;
+  float GetNorm(size_t doc) const;
+
+private:
+  // The number of positive documents, and of all the documents.
+  size_t pos_docs;
+  size_t docs;
+
+  // The number of terms in the term_set.
+  size_t terms;
+
+  // The number of terms of every document added up.
+  size_t postings;
+
+  const uint64_t *offsets;
+  const uint32_t *term_ids;
+  const float *weights;
+
+  // The square root of the sum of the squared weights of every document,
+  // added up in the order of the terms.
+  const float *norms;
+
+  // The arrays built from the training statistics.
+  std::vector<uint64_t> built_offsets;
+  std::vector<uint32_t> built_term_ids;
+  std::vector<float> built_weights;
+  std::vector<float> built_norms;
+};
+
+#endif
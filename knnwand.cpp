@@ -0,0 +1,186 @@
+#include "knnwand.h"
+
+#include <algorithm>
+#include <limits>
+
+// The postings of a term of the testing document, walked in the order of
+// the documents.
+struct WandCursor {
+  size_t term;
+  size_t posting;
+  size_t end;
+  float weight;
+  double bound;
+};
+
+KNNWand::KNNWand() {}
+
+KNNWand::~KNNWand() {}
+
+bool KNNWand::Build(const KNNTrainingSet &training_set) {
+
+  if ( KNNIndex::Build(training_set) == false ) {
+    return false;
+  }
+
+  size_t terms = training->GetTermsSize();
+  max_ratios.assign(terms, 0);
+  for ( size_t t = 0; t < terms; t++ ) {
+    for ( size_t p = offsets[t]; p < offsets[t + 1]; p++ ) {
+      float norm = training->GetNorm(posting_docs[p]);
+      if ( norm > 0 ) {
+        max_ratios[t] = std::max(max_ratios[t], posting_weights[p] / norm);
+      }
+    }
+  }
+
+  return true;
+}
+
+void KNNWand::Search(const TermWeights &test, size_t k,
+  std::vector<KNNResult> &results) const {
+
+  if ( test.size() == 0 ) {
+    SearchEmpty(k, results);
+    return;
+  }
+  results.clear();
+
+  SearchRange(test, k, 0, training->Size(), results);
+
+  FillTopK(k, GetNorm(test), results);
+}
+
+// The threshold of a range is the last of the top k of the range, which is
+// never above the last of the whole top k, so no document of the top k is
+// skipped.
+void KNNWand::SearchRange(const TermWeights &test, size_t k, size_t first,
+  size_t last, std::vector<KNNResult> &results) const {
+
+  float norm_test = GetNorm(test);
+
+  // The cursors, in the order of the terms, and the cursors that still
+  // have postings, sorted by their current document.
+  std::vector<WandCursor> cursors;
+  std::vector<WandCursor*> active;
+  cursors.reserve(test.size());
+  for ( auto it_term : test ) {
+    WandCursor cursor;
+    cursor.term = it_term.first;
+    cursor.posting = FirstPosting(it_term.first, first);
+    cursor.end = FirstPosting(it_term.first, last);
+    cursor.weight = it_term.second;
+    cursor.bound = static_cast<double>(it_term.second) *
+        max_ratios[it_term.first] / norm_test;
+    cursors.push_back(cursor);
+  }
+  for ( size_t i = 0; i < cursors.size(); i++ ) {
+    if ( cursors[i].posting < cursors[i].end ) {
+      active.push_back(&cursors[i]);
+    }
+  }
+  std::vector<WandCursor*> scored(active.size());
+
+  // Every rounding of a sum of n floats is below 2^-24 of the sum, so a
+  // margin of a millionth for every term keeps the bounds above the
+  // similarities calculated.
+  const double margin = 1 + 1e-6 * (test.size() + 16);
+
+  while ( active.empty() == false ) {
+
+    // Only the cursors moved on the last step are out of place, so an
+    // insertion sort restores the order of the documents quickly.
+    for ( size_t i = 1; i < active.size(); i++ ) {
+      WandCursor *cursor = active[i];
+      uint32_t doc = posting_docs[cursor->posting];
+      size_t j = i;
+      while ( j > 0 && posting_docs[active[j - 1]->posting] > doc ) {
+        active[j] = active[j - 1];
+        j--;
+      }
+      active[j] = cursor;
+    }
+
+    // Until the top k is full, every document is scored. After that, a
+    // document must reach the similarity of the last of the top k.
+    double threshold = -std::numeric_limits<double>::infinity();
+    if ( results.size() == k ) {
+      threshold = results.back().similarity;
+    }
+
+    // Find the pivot, the first cursor where the sum of the bounds of the
+    // cursors up to it could reach the threshold. The documents before
+    // the document of the pivot can not enter the top k.
+    double bound = 0;
+    size_t pivot = active.size();
+    for ( size_t i = 0; i < active.size(); i++ ) {
+      bound += active[i]->bound;
+      if ( bound * margin >= threshold ) {
+        pivot = i;
+        break;
+      }
+    }
+    if ( pivot == active.size() ) {
+      break;
+    }
+
+    uint32_t pivot_doc = posting_docs[active[pivot]->posting];
+
+    if ( posting_docs[active[0]->posting] == pivot_doc ) {
+
+      // The cursors on the document come first, since the cursors are
+      // sorted by document. Sort them by term, and score the document,
+      // adding up the dot product in the order of the terms, like the
+      // brute force search.
+      size_t matched = pivot + 1;
+      while ( matched < active.size() &&
+          posting_docs[active[matched]->posting] == pivot_doc ) {
+        matched++;
+      }
+      for ( size_t i = 0; i < matched; i++ ) {
+        scored[i] = active[i];
+      }
+      std::sort(scored.begin(), scored.begin() + matched,
+          [](const WandCursor *a, const WandCursor *b) {
+            return a->term < b->term;
+          });
+
+      float nom = 0;
+      for ( size_t i = 0; i < matched; i++ ) {
+        nom += scored[i]->weight * posting_weights[scored[i]->posting];
+        scored[i]->posting++;
+      }
+
+      float similarity = Similarity(pivot_doc, nom, norm_test);
+      if ( similarity > 0 ) {
+        AddTopK(results, k, pivot_doc, similarity);
+      }
+    }
+    else {
+
+      // Move the cursors before the pivot to the document of the pivot.
+      for ( size_t i = 0; i < pivot; i++ ) {
+        WandCursor *cursor = active[i];
+        const uint32_t *first = posting_docs.data() + cursor->posting;
+        const uint32_t *last = posting_docs.data() + cursor->end;
+        cursor->posting += std::lower_bound(first, last, pivot_doc) - first;
+      }
+    }
+
+    // Drop the cursors that ran out of postings.
+    size_t kept = 0;
+    for ( size_t i = 0; i < active.size(); i++ ) {
+      if ( active[i]->posting < active[i]->end ) {
+        active[kept++] = active[i];
+      }
+    }
+    active.resize(kept);
+  }
+}
+
+// Every testing document skips different training documents, so the
+// documents of a batch are searched one at a time.
+void KNNWand::SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+  std::vector<std::vector<KNNResult>> &results) const {
+  KNNSearch::SearchBatch(tests, k, results);
+}
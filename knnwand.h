@@ -0,0 +1,32 @@
+#ifndef KNNWAND_H
+#define KNNWAND_H
+
+#include "knnindex.h"
+
+// Walks the postings of the inverted index a document at a time, in the
+// order of the documents, using WAND to skip the documents that can not
+// enter the top k. For every term, it keeps the greatest weight of the
+// term divided by the norm of a document, which bounds the similarity the
+// term can add to any document. The bounds are loosened by a margin
+// covering the rounding of the sums, so the top k stays exactly the same
+// as the brute force search.
+class KNNWand : public KNNIndex {
+public:
+  KNNWand();
+  ~KNNWand();
+
+  bool Build(const KNNTrainingSet &training_set);
+  void Search(const TermWeights &test, size_t k,
+      std::vector<KNNResult> &results) const;
+  void SearchBatch(const std::vector<TermWeights> &tests, size_t k,
+      std::vector<std::vector<KNNResult>> &results) const;
+  void SearchRange(const TermWeights &test, size_t k, size_t first,
+      size_t last, std::vector<KNNResult> &results) const;
+
+private:
+  // The greatest weight of every term divided by the norm of the document,
+  // indexed by the order of the term.
+  std::vector<float> max_ratios;
+};
+
+#endif
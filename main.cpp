@@ -1,15 +1,17 @@
 #include "meansmethod.h"
 #include "tagsmethod.h"
 #include "knnmethod.h"
+#include "corpus.h"
+#include "trainingstats.h"
+#include "model.h"
+#include "tokenizer.h"
+#include "classifyserver.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <dirent.h>
 
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <algorithm> // ::tolower
 
 // The directory where the source code is.
 std::string cwd = "/home/alex/Documents/OpinionMining";
@@ -31,18 +33,30 @@ std::string parsed_pos = "/pos/";
 std::string parsed_neg = "/neg/";
 std::string parsed_test = "/test/";
 
-// Delimiters used to split the lines during the parsing of
-// the raw documents
-std::string delimiters = " .,:;?!><-\"/()";
-
-// Common words. If any of these words are found in the raw
-// documents, while parsing them, they will be discarded.
-const size_t commons_size = 28;
-std::string commons[commons_size] = {
-  "the", "to", "of", "and", "a", "an", "that", "in",
-  "it", "with", "as", "do", "there", "they", "we",
-  "she", "he", "or", "will", "one", "this", "by", "so",
-  "just", "i", "for", "these", "them"
+// The options given as arguments. By default, the raw documents are
+// parsed in memory and every algorithm is run. The parsed documents are
+// only written on the disk when write_parsed is set, or when no algorithm
+// is run, since they are useful only for debugging or later runs.
+// The documents are parsed, the training statistics are gathered, and
+// the testing documents are classified, by the given number of threads.
+// If a stopwords file is given, its words replace the default common
+// words discarded from the documents.
+// The knn method finds the nearest training documents with the search
+// given in the knn options. The trained model is written in save_model,
+// if given. If load_model is given, the model is read from it instead,
+// and the training documents are neither parsed nor trained on. If serve
+// is given, no testing document is read, and the documents sent to the
+// socket serve are classified instead, until the server is stopped.
+struct Options {
+  bool pre_parse = true;
+  bool write_parsed = false;
+  std::string algorithm = "ALL";
+  size_t threads = 1;
+  std::string stopwords = "";
+  std::string save_model = "";
+  std::string load_model = "";
+  std::string serve = "";
+  KNNOptions knn;
 };
 
 bool CreateWindowsDir(std::string directory) {
@@ -89,248 +103,160 @@ bool CreateDirectories() {
   return return_value;
 }
 
-// Gets a directory and an index and returns the name of the file
-// corresponding to the index. For example, if the index is 2, the
-// returned file will be "2_R.txt" or "00002.txt", depending on the
-// type of directory (training or testing).
-std::string GetFile(std::string directory, size_t index, std::string type) {
-
-  std::string found_file = "";
-
-  DIR *dirp;
-  struct dirent *ent;
-
-  // Open a directory stream pointing to the directory where the
-  // documents are located.
-  dirp = opendir(directory.c_str());
-
-  // If there are no errors, a pointer to the directory is returned.
-  // Else, NULL is returned.
-  if ( dirp != NULL ) {
-
-    // Get the next directory entry in the stream.
-    // NULL is returned when reaching the end.
-    while ( (ent = readdir(dirp)) != NULL ) {
-
-      // Get the name of the current document.
-      std::string file_name = ent->d_name;
-
-      // Exclude the . and .. directories.
-      if ( file_name != "." && file_name != ".." ) {
-
-        // The search_name string is constructed depending on the
-        // type of the directory. The type can be "train" or "test".
-        // Construct the search name, check if the search name points
-        // to the document's name, and return.
-        std::string search_name;
-        if ( type == "train" ) {
-          search_name = std::to_string(index) + "_";
-          if ( file_name.substr(0, search_name.length() ) == search_name ) {
-            found_file = file_name;
-          }
-        }
-        else if ( type == "test") {
-          size_t digits = (std::to_string(index)).length();
-          std::string zeroes = "";
-          for ( size_t i = 0; i < 5 - digits; i++) {
-            zeroes += "0";
-          }
-          search_name = zeroes + std::to_string(index) + ".txt";
-          if ( file_name == search_name ) {
-            found_file = file_name;
-          }
-        }
-        else {
-          std::cout << "Error: Wrong directory type: " << type << std::endl;
-        }
+// Loads the documents of a directory in memory. If pre_parse is set,
+// the raw documents in the directory are parsed, removing any common
+// words, punctuations, and making all letters lowercase. Else, the
+// documents that were parsed on a previous run are read from the
+// parsed directory.
+bool LoadData(Corpus &corpus, std::string directory,
+  std::string parsed_directory, std::string type, const Options &options) {
 
-      }
+  if ( options.pre_parse == true ) {
 
+    // Write the parsed documents on the disk, only if asked to.
+    std::string output_dir = "";
+    if ( options.write_parsed == true || options.algorithm == "NONE" ) {
+      output_dir = parsed_directory;
     }
 
-    // Close the directory stream.
-    closedir (dirp);
-  }
-  else {
-    std::cout << "Error: Could not open directory " << directory << std::endl;
+    if ( corpus.LoadRaw(directory, type, output_dir) == false ) {
+      return false;
+    }
   }
-  
-  return found_file;
-}
-
-// Parses the documents in the given directory, removing any
-// common words, punctuations, and makes at letters lowercase.
-bool ParseData(std::string directory, std::string type) {
-
-  // Depending on the directory given, create the output
-  // directory where the parsed documents will be stored.
-  std::string output_dir;
-  if ( directory == cwd + pos_dir )
-    output_dir = cwd + parsed_dir + parsed_pos;
-  else if ( directory == cwd + neg_dir )
-    output_dir = cwd + parsed_dir + parsed_neg;
-  else if ( directory == cwd + test_dir )
-    output_dir = cwd + parsed_dir + parsed_test;
   else {
-    std::cout << "Error: Input directory " << directory;
-    std::cout << " is not valid." << std::endl;
-    return false;
-  }
-
-  // Read the documents from the directory in ascending order,
-  // starting from the document corresponding to the index.
-  size_t index = 0;
-
-  while ( true ) {
-
-    // Get the document name based on the directory,
-    // index, and type of directory.
-    std::string file_name = GetFile(directory, index, type);
-
-    // If a document was not found, break the loop,
-    // else parse the file.
-    if ( file_name == "" ) {
-      std::cout << '\r' << "\tParsed " << index << " files from ";
-      std::cout << directory << std::endl;
-      break;
+    if ( corpus.LoadParsed(parsed_directory, type) == false ) {
+      return false;
     }
-    else {
-
-      std::ifstream input_file(directory + file_name);
-      if ( input_file.is_open() ) {
-
-        // Word vector will be storing every valid word from the input
-        // document. The content of the vector will be written on the
-        // output document.
-        std::vector<std::string> word_vector;
-
-        // Read the file, line by line.
-        std::string line;
-        while ( getline(input_file, line) ) {
-
-          // Split the line based on delimiters.
-          // The start and end variables serve as pointers to the start
-          // and end of every word. Iterate through the line, each time
-          // finding the closest to the start variable, delimiter character.
-          // Extract the word and process it. Set the new start value as the
-          // position of the character after the start. Stop on reaching the
-          // end of the line.
-          size_t start = 0, end;
-          while ( start < line.length() ) {
-
-            // Find where the first delimiter character is located.
-            // If there are no delimiters, meaning the returned value was
-            // string::npos, set the end variable as the end of the line.
-            end = line.find_first_of(delimiters, start);
-            if ( end == std::string::npos ) {
-              end = line.length();
-            }
-
-            // Extract the word based on the start and end values.
-            std::string wrd = line.substr(start, end - start);
-
-            if ( wrd.length() > 0 ) {
-
-              // Make the word lowercase.
-              std::transform(wrd.begin(), wrd.end(), wrd.begin(), ::tolower);
-
-              // Search if this word is a common word.
-              bool is_common = false;
-              for ( size_t i = 0; i < commons_size; i++ ) {
-                if ( wrd == commons[i] ) {
-                  is_common = true;
-                }
-              }
-
-              if ( is_common == false ) {
-                word_vector.push_back(wrd);
-              }
-
-            }
-
-            start = end + 1;
-          }
-        }
-
-        // Write the words from the word vector on the output
-        // document, seperated by a space.
-        std::ofstream output_file(output_dir + file_name);
-        if ( output_file.is_open() ) {
-          for ( size_t i = 0; i < word_vector.size(); i++ ) {
-            output_file << word_vector.at(i);
-            if ( i < word_vector.size() - 1 ) {
-              output_file << " ";
-            }
-          }
-        }
-        else {
-          std::cout << "Error: Could not open output file ";
-          std::cout << output_dir + file_name << std::endl;
-          return false;
-        }
+  }
 
-        // Close the input and output file streams.
-        input_file.close();
-        output_file.close();
-      }
-      else {
-        std::cout << "Error: Could not open input file ";
-        std::cout << directory + file_name << std::endl;
-        return false;
-      }
+  return true;
+}
 
-    }
+// Reads the number given as the value of an argument. Fails if the value
+// is not a number, or is less than the minimum.
+bool ParseNumber(std::string arg, std::string value, size_t minimum,
+  size_t &number) {
 
-    // Have a counter notifying the user about the progress.
-    if ( index % 10 == 0) {
-      std::cout << "\r\t" << index;
-      fflush(stdout);
-    }
-    index++;
+  if ( value.empty() || value.size() > 18 ||
+      value.find_first_not_of("0123456789") != std::string::npos ||
+      std::stoul(value) < minimum ) {
+    std::cout << "Error: Invalid value " << value << " for " << arg;
+    std::cout << std::endl;
+    return false;
   }
 
+  number = std::stoul(value);
   return true;
 }
 
-bool ParseArgs(int argc, char* argv[],
-  bool &pre_parse, std::string &algorithm) {
+bool ParseArgs(int argc, char* argv[], Options &options) {
 
   bool return_value = true;
 
   if ( argc == 1) {
     std::cout << "No arguments given, running preparse and ";
     std::cout << "all algorithms." << std::endl;
-    pre_parse = true;
-    algorithm = "ALL";
-  }
-  else if ( argc > 3 ) {
-    std::cout << "Error: Invalid number of arguments given - ";
-    std::cout << (argc-1) << std::endl;
-    return_value = false;
+    options.pre_parse = true;
+    options.algorithm = "ALL";
   }
   else {
     for ( int i = 1; i < argc; i++ ) {
       std::string arg = argv[i];
       if ( arg == "--pre-parse" ) {
-        pre_parse = true;
+        options.pre_parse = true;
       }
       else if ( arg == "--no-parse" ) {
-        pre_parse = false;
+        options.pre_parse = false;
+      }
+      else if ( arg == "--write-parsed" ) {
+        options.write_parsed = true;
+      }
+      else if ( arg == "--threads" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1, options.threads) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--stopwords" && i + 1 < argc ) {
+        options.stopwords = argv[++i];
+      }
+      else if ( arg == "--save-model" && i + 1 < argc ) {
+        options.save_model = argv[++i];
+      }
+      else if ( arg == "--load-model" && i + 1 < argc ) {
+        options.load_model = argv[++i];
+      }
+      else if ( arg == "--serve" && i + 1 < argc ) {
+        options.serve = argv[++i];
+      }
+      else if ( arg == "--knn-search" && i + 1 < argc ) {
+        options.knn.search = argv[++i];
+      }
+      else if ( arg == "--lsh-bands" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1, options.knn.lsh_bands) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--lsh-rows" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1, options.knn.lsh_rows) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--ivf-clusters" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 0,
+              options.knn.ivf_clusters) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--ivf-nprobe" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1,
+              options.knn.ivf_nprobe) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--projection-dims" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1,
+              options.knn.projection_dims) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--projection-candidates" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1,
+              options.knn.projection_candidates) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--knn-batch" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1,
+              options.knn.batch_size) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--knn-threads" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 1,
+              options.knn.search_threads) == false ) {
+          return_value = false;
+        }
+      }
+      else if ( arg == "--knn-recall" && i + 1 < argc ) {
+        if ( ParseNumber(arg, argv[++i], 0,
+              options.knn.recall_docs) == false ) {
+          return_value = false;
+        }
       }
       else if ( arg == "--means" ) {
-        algorithm = "MEANS";
+        options.algorithm = "MEANS";
       }
       else if ( arg == "--tags" ) {
-        algorithm = "TAGS";
+        options.algorithm = "TAGS";
       }
       else if ( arg == "--k-nearest" ) {
-        algorithm = "KNN";
+        options.algorithm = "KNN";
       }
       else if ( arg == "--all" ) {
-        algorithm = "ALL";
+        options.algorithm = "ALL";
       }
       else if ( arg == "--none" ) {
-        algorithm = "NONE";
+        options.algorithm = "NONE";
       }
       else {
         std::cout << "Error: Invalid argument " << arg << std::endl;
@@ -342,12 +268,44 @@ bool ParseArgs(int argc, char* argv[],
   return return_value;
 }
 
-bool RunMeans(size_t step) {
+bool BuildStats(size_t step, TrainingStats &stats) {
+
+  std::cout << "Step " << step << ": Gathering the training statistics.";
+  std::cout << std::endl;
+
+  if ( stats.Build() == false ) {
+    std::cout << "Error: Aborted while gathering the training statistics.";
+    std::cout << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+// Creates the trained state of the methods that are run, or of every
+// method if the model is saved or served.
+bool BuildModel(size_t step, const TrainingStats &stats, Model &model,
+  const Options &options) {
+
+  std::cout << "Step " << step << ": Training the model." << std::endl;
+
+  bool all = options.algorithm == "ALL" || options.save_model != "" ||
+      options.serve != "";
+  if ( model.Build(stats, all || options.algorithm == "MEANS",
+        all || options.algorithm == "TAGS",
+        all || options.algorithm == "KNN") == false ) {
+    std::cout << "Error: Aborted while training the model." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool RunMeans(size_t step, const Corpus &test_corpus,
+  const Model &model, const Options &options) {
   
   MeansMethod meansMethod(
-      cwd, cwd + parsed_dir + parsed_pos,
-      cwd + parsed_dir + parsed_neg,
-      cwd + parsed_dir + parsed_test, result_dir );
+      cwd, test_corpus, result_dir, model, options.threads );
 
   std::cout << "Step " << step << ": Running means method algorithm.";
   std::cout << std::endl;
@@ -360,12 +318,11 @@ bool RunMeans(size_t step) {
   return true;
 }
 
-bool RunTags(size_t step) {
+bool RunTags(size_t step, const Corpus &test_corpus,
+  const Model &model, const Options &options) {
   
   TagsMethod tagsMethod(
-      cwd, cwd + parsed_dir + parsed_pos,
-      cwd + parsed_dir + parsed_neg,
-      cwd + parsed_dir + parsed_test, result_dir );
+      cwd, test_corpus, result_dir, model, options.threads );
   
   std::cout << "Step " << step << ": Running tags method algorithm.";
   std::cout << std::endl;
@@ -378,12 +335,11 @@ bool RunTags(size_t step) {
   return true;
 }
 
-bool RunKNearest(size_t step) {
+bool RunKNearest(size_t step, const Corpus &test_corpus,
+  const Model &model, const Options &options) {
 
   KNNMethod knnMethod(
-      cwd, cwd + parsed_dir + parsed_pos,
-      cwd + parsed_dir + parsed_neg,
-      cwd + parsed_dir + parsed_test, result_dir );
+      cwd, test_corpus, result_dir, model, options.threads, options.knn );
   
   std::cout << "Step " << step << ": Running k-nearest neighbors ";
   std::cout << "method algorithm.";
@@ -397,11 +353,52 @@ bool RunKNearest(size_t step) {
   return true;
 }
 
+// Answers the classification requests sent to the socket, with every
+// method sharing the model, until the server is stopped. A model file is
+// loaded by the server itself, so it can be released once the server
+// replaces it. A trained model is owned by the caller.
+bool Serve(size_t step, Vocabulary &vocabulary, const Model &model,
+  const Options &options) {
+
+  std::cout << "Step " << step << ": Serving the classification requests.";
+  std::cout << std::endl;
+
+  std::unique_ptr<ServedModel> served;
+  if ( options.load_model != "" ) {
+    std::cout << "\tLoading the model from " << options.load_model;
+    std::cout << std::endl;
+    std::unique_ptr<LoadedModel> loaded(new LoadedModel);
+    if ( loaded->model.Load(options.load_model, loaded->vocabulary) ==
+        false ) {
+      return false;
+    }
+    served.reset(new ServedModel(std::move(loaded), options.threads,
+          options.knn));
+  }
+  else {
+    served.reset(new ServedModel(vocabulary, model, options.threads,
+          options.knn));
+  }
+
+  if ( served->Prepare() == false ) {
+    std::cout << "Error: Could not prepare the methods." << std::endl;
+    return false;
+  }
+
+  ClassifyServer server(std::move(served), options.load_model,
+      options.threads, options.knn);
+  if ( server.Run(options.serve) == false ) {
+    std::cout << "Error: Aborted while serving." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
 int main(int argc, char* argv[]) {
 
-  bool pre_parse = true;
-  std::string algorithm = "ALL";
-  if ( ParseArgs(argc, argv, pre_parse, algorithm) == false ) {
+  Options options;
+  if ( ParseArgs(argc, argv, options) == false ) {
     std::cout << "Error: Invalid arguments given." << std::endl;
     return -1;
   }
@@ -414,36 +411,119 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  if ( pre_parse == true) {
+  // The words of the positive, negative and testing documents. They are
+  // fed straight to the training and classification stages. Every
+  // document shares the same vocabulary, so a word has the same ID in
+  // the training and the testing documents.
+  Vocabulary vocabulary;
+  Corpus pos_corpus(options.threads, vocabulary);
+  Corpus neg_corpus(options.threads, vocabulary);
+  Corpus test_corpus(options.threads, vocabulary);
+
+  bool serve = options.serve != "";
+  bool load_model = options.load_model != "";
+  if ( serve == true && load_model == true && options.save_model != "" ) {
+    std::cout << "Error: A served model file can not be saved again.";
+    std::cout << std::endl;
+    return -1;
+  }
+
+  // The stopwords are read before any model file, which is checked
+  // against them.
+  if ( options.stopwords != "" ) {
+    if ( LoadStopWords(options.stopwords) == false ) {
+      return -1;
+    }
+  }
+
+  // A model read from a file gives every word of the training run the
+  // same ID as before, so it is read before any document. A served model
+  // file is read by the server instead.
+  Model model;
+  if ( load_model == true && serve == false ) {
+    std::cout << "Step " << ++step << ": Loading the model from ";
+    std::cout << options.load_model << std::endl;
+    if ( model.Load(options.load_model, vocabulary) == false ) {
+      return -1;
+    }
+  }
+
+  // The requests of the server are raw documents, tokenized like the
+  // documents parsed in memory.
+  if ( options.pre_parse == true || serve == true ) {
     std::cout << "Step " << ++step << ": Parsing the data." << std::endl;
-    if ( ParseData(cwd + pos_dir, "train") == false ||
-        ParseData(cwd + neg_dir, "train") == false ||
-        ParseData(cwd + test_dir, "test") == false) {
-     std::cout << "Error: Could not parse the data." << std::endl;
-     return -1;
+    std::cout << "\tScanning the text with the " << InitTokenizer();
+    std::cout << " kernel." << std::endl;
+
+    if ( options.stopwords != "" ) {
+      std::cout << "\tLoaded " << GetStopWordsSize() << " stopwords from ";
+      std::cout << options.stopwords << std::endl;
     }
   }
+  else if ( options.algorithm != "NONE" ) {
+    std::cout << "Preparse was set to false. Reading the parsed data.";
+    std::cout << std::endl;
+  }
   else {
     std::cout << "Preparse was set to false. Skipping." << std::endl;
   }
-  
+
+  bool train = load_model == false &&
+      (options.algorithm != "NONE" || options.save_model != "" ||
+       serve == true);
+
+  if ( options.pre_parse == true || train == true ||
+      options.algorithm != "NONE" ) {
+    if ( (load_model == false && (LoadData(pos_corpus, cwd + pos_dir,
+          cwd + parsed_dir + parsed_pos, "train", options) == false ||
+        LoadData(neg_corpus, cwd + neg_dir,
+          cwd + parsed_dir + parsed_neg, "train", options) == false)) ||
+        (serve == false && LoadData(test_corpus, cwd + test_dir,
+          cwd + parsed_dir + parsed_test, "test", options) == false) ) {
+     std::cout << "Error: Could not parse the data." << std::endl;
+     return -1;
+    }
+  }
+
   bool return_value = true;
 
-  if ( algorithm == "MEANS" ) {
-    return_value = RunMeans(++step);
+  // The training statistics are gathered once, in a single pass over the
+  // positive and negative documents, and the model built from them is
+  // shared by every method.
+  TrainingStats stats(pos_corpus, neg_corpus, options.threads);
+  if ( train == true ) {
+    if ( BuildStats(++step, stats) == false ||
+        BuildModel(++step, stats, model, options) == false ) {
+      return -1;
+    }
+  }
+
+  if ( options.save_model != "" ) {
+    std::cout << "Step " << ++step << ": Saving the model in ";
+    std::cout << options.save_model << std::endl;
+    if ( model.Save(options.save_model, vocabulary) == false ) {
+      return -1;
+    }
+  }
+
+  if ( serve == true ) {
+    return_value = Serve(++step, vocabulary, model, options);
+  }
+  else if ( options.algorithm == "MEANS" ) {
+    return_value = RunMeans(++step, test_corpus, model, options);
   }
-  else if ( algorithm == "TAGS" ) {
-    return_value = RunTags(++step);
+  else if ( options.algorithm == "TAGS" ) {
+    return_value = RunTags(++step, test_corpus, model, options);
   }
-  else if ( algorithm == "KNN" ) {
-    return_value = RunKNearest(++step);
+  else if ( options.algorithm == "KNN" ) {
+    return_value = RunKNearest(++step, test_corpus, model, options);
   }
-  else if ( algorithm == "ALL" ) {
-    return_value = RunMeans(++step);
-    return_value = RunTags(++step);
-    return_value = RunKNearest(++step);
+  else if ( options.algorithm == "ALL" ) {
+    return_value = RunMeans(++step, test_corpus, model, options);
+    return_value = RunTags(++step, test_corpus, model, options);
+    return_value = RunKNearest(++step, test_corpus, model, options);
   }
-  else if ( algorithm == "NONE" ) {
+  else if ( options.algorithm == "NONE" ) {
     std::cout << "Running algorithm was set to false. Skipping." << std::endl;
   }
   else {
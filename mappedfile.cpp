@@ -0,0 +1,75 @@
+#include "mappedfile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile() : data(nullptr), size(0) {}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(std::string path) {
+  return Map(path, false);
+}
+
+bool MappedFile::OpenReadOnly(std::string path) {
+  return Map(path, true);
+}
+
+// Maps the whole file in memory. An empty file can not be mapped, so it
+// is left with no data and a size of 0.
+bool MappedFile::Map(std::string path, bool read_only) {
+
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if ( fd < 0 ) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if ( fstat(fd, &file_stat) != 0 ) {
+    close(fd);
+    return false;
+  }
+
+  if ( file_stat.st_size > 0 ) {
+    void *mapped = mmap(nullptr, file_stat.st_size,
+        read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+        read_only ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if ( mapped == MAP_FAILED ) {
+      close(fd);
+      return false;
+    }
+    data = static_cast<char*>(mapped);
+    size = file_stat.st_size;
+  }
+
+  // The mapping stays valid after the file is closed.
+  close(fd);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if ( data != nullptr ) {
+    munmap(data, size);
+  }
+  data = nullptr;
+  size = 0;
+}
+
+char *MappedFile::Data() {
+  return data;
+}
+
+size_t MappedFile::Size() const {
+  return size;
+}
+
+std::string_view MappedFile::GetText() const {
+  return std::string_view(data, size);
+}
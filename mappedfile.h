@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+// A file mapped in memory, so its bytes can be read without copying them
+// in a buffer. The mapping is private, meaning it can also be modified in
+// place (for example to make the text lowercase) without changing the
+// file on the disk. A file opened read-only is mapped shared instead, so
+// every process mapping it reads the same pages of the page cache. The
+// mapping is released when the object is destroyed, so any views of the
+// text must not outlive it.
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(std::string path);
+  bool OpenReadOnly(std::string path);
+  void Close();
+
+  char *Data();
+  size_t Size() const;
+  std::string_view GetText() const;
+
+private:
+  bool Map(std::string path, bool read_only);
+
+  char *data;
+  size_t size;
+};
+
+#endif
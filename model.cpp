@@ -0,0 +1,350 @@
+#include "model.h"
+#include "knnsearch.h"
+#include "tokenizer.h"
+
+#include <iostream>
+
+Model::Model() {}
+
+Model::~Model() {}
+
+// Creates the trained state of the chosen methods, using the term maps
+// of the training statistics.
+bool Model::Build(const TrainingStats &stats, bool means, bool tags,
+  bool knn) {
+
+  reader.Close();
+  CreateTermIndex(stats);
+
+  if ( means == true ) {
+    std::cout << "\tCreating the means vectors." << std::endl;
+    CreateMeansVectors(stats);
+  }
+
+  if ( tags == true ) {
+    std::cout << "\tCalculating the term scores." << std::endl;
+    CreateTagScores(stats);
+  }
+
+  if ( knn == true ) {
+    std::cout << "\tCreating the knn vectors." << std::endl;
+    if ( knn_training_set.Build(stats) == false ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// The first cell of the term in the hash index. The hash must never
+// change, as the index is stored in the model files.
+static size_t TermHome(TermKey term, size_t capacity) {
+  return MixBits(term) & (capacity - 1);
+}
+
+// Inserts every term of the term_set in the hash index, along with its
+// order and its nidf, so the testing documents look the terms up without
+// the unordered map of the training statistics.
+void Model::CreateTermIndex(const TrainingStats &stats) {
+
+  const auto &term_set = stats.GetTermSet();
+
+  terms = term_set.size();
+  term_capacity = 1;
+  while ( term_capacity < 2 * terms ) {
+    term_capacity *= 2;
+  }
+
+  TermSlot empty_slot = {0, 0, 0};
+  built_term_slots.assign(term_capacity, empty_slot);
+  for ( auto &it_term : term_set ) {
+    size_t slot = TermHome(it_term.first, term_capacity);
+    while ( built_term_slots[slot].key != 0 ) {
+      slot = (slot + 1) & (term_capacity - 1);
+    }
+    built_term_slots[slot].key = it_term.first;
+    built_term_slots[slot].order = it_term.second.order;
+    built_term_slots[slot].nidf = it_term.second.nidf;
+  }
+
+  term_slots = built_term_slots.data();
+  good_vector = nullptr;
+  bad_vector = nullptr;
+  tag_scores = nullptr;
+}
+
+// For every term in the term_set, add the weight of this term from
+// the good(bad)_terms, in the cell of the good(bad)_vector indicated
+// by the term's order. If the term is not in the good(bad)_terms, 0 is
+// added as the weight.
+void Model::CreateMeansVectors(const TrainingStats &stats) {
+
+  const auto &good_terms = stats.GetGoodTerms();
+  const auto &bad_terms = stats.GetBadTerms();
+
+  const auto &term_set = stats.GetTermSet();
+
+  built_good_vector.assign(terms, 0);
+  built_bad_vector.assign(terms, 0);
+
+  for ( auto it_term : term_set ) {
+
+    TermKey term = it_term.first;
+    size_t id = it_term.second.order;
+
+    auto found_good = good_terms.find(term);
+    if ( found_good != good_terms.end() ) {
+      built_good_vector.at(id) = found_good->second.weight;
+    }
+
+    auto found_bad = bad_terms.find(term);
+    if ( found_bad != bad_terms.end() ) {
+      built_bad_vector.at(id) = found_bad->second.weight;
+    }
+
+  }
+
+  good_vector = built_good_vector.data();
+  bad_vector = built_bad_vector.data();
+}
+
+// Using the total frequency of every term in the good(bad)_terms, find
+// the frequency of the most common term in the positive (negative)
+// documents, and then calculate the score of each term in the term_set.
+// The score is stored in the cell of the tag_scores indicated by the
+// term's order.
+void Model::CreateTagScores(const TrainingStats &stats) {
+
+  const auto &term_set = stats.GetTermSet();
+  const auto &good_terms = stats.GetGoodTerms();
+  const auto &bad_terms = stats.GetBadTerms();
+
+  // The frequency of the most common term in the positive (negative)
+  // documents. Used to create normalized scores in the term_set map.
+  float max_good_freq = 0, max_bad_freq = 0;
+
+  // Find the frequency of the most common term in the good_terms.
+  for ( auto &it_term : good_terms ) {
+    if ( it_term.second.freq > max_good_freq ) {
+      max_good_freq = it_term.second.freq;
+    }
+  }
+
+  // Find the frequency of the most common term in the bad_terms.
+  for ( auto &it_term : bad_terms ) {
+    if ( it_term.second.freq > max_bad_freq ) {
+      max_bad_freq = it_term.second.freq;
+    }
+  }
+
+  built_tag_scores.assign(terms, 0);
+
+  // Calculate the tag value (score) for every term in the term_set.
+  for ( auto &it_term : term_set ) {
+
+    float tag_score = 0;
+    size_t good_w = 0, bad_w = 0;
+
+    // Get the total frequency of the term in the pos documents.
+    auto found_good = good_terms.find(it_term.first);
+    if ( found_good != good_terms.end() ) {
+      good_w = found_good->second.freq;
+    }
+
+    // Get the total frequency of the term in the neg documents.
+    auto found_bad = bad_terms.find(it_term.first);
+    if ( found_bad != bad_terms.end() ) {
+      bad_w = found_bad->second.freq;
+    }
+
+    tag_score = (good_w / max_good_freq) - (bad_w / max_bad_freq);
+
+    built_tag_scores.at(it_term.second.order) = tag_score;
+
+  }
+
+  tag_scores = built_tag_scores.data();
+}
+
+// Writes the model, which must have been built for every method, or
+// loaded. The stopwords come first, so a model is only loaded with the
+// stopwords it was trained with. The words of the vocabulary are written
+// one after another, along with the offset of every word, and the hash
+// index of the term_set is written as it is, so it is used in place when
+// the model is loaded.
+bool Model::Save(std::string path, const Vocabulary &vocabulary) const {
+
+  if ( term_slots == nullptr || good_vector == nullptr ||
+      bad_vector == nullptr || tag_scores == nullptr ||
+      knn_training_set.GetTermsSize() != terms ) {
+    std::cout << "\tError: The model was not built for every method.";
+    std::cout << std::endl;
+    return false;
+  }
+
+  // The empty word always has the ID 0, and is not written.
+  std::string words;
+  std::vector<uint64_t> word_offsets(1, 0);
+  word_offsets.reserve(vocabulary.Size());
+  for ( size_t id = 1; id < vocabulary.Size(); id++ ) {
+    words += vocabulary.GetWord(id);
+    word_offsets.push_back(words.size());
+  }
+
+  std::string stopwords = GetStopWords();
+
+  ModelWriter writer;
+  if ( writer.Open(path) == true ) {
+    writer.WriteArray(stopwords.data(), stopwords.size());
+    writer.WriteArray(words.data(), words.size());
+    writer.WriteArray(word_offsets);
+    writer.WriteArray(term_slots, term_capacity);
+    writer.WriteArray(good_vector, terms);
+    writer.WriteArray(bad_vector, terms);
+    writer.WriteArray(tag_scores, terms);
+    knn_training_set.Save(writer);
+  }
+
+  if ( writer.Close() == false ) {
+    std::cout << "\tError: Could not write the model file " << path;
+    std::cout << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+// Maps a model written by Save(), and points every array in the mapping.
+// The vocabulary must be empty, so every word gets back the ID it had when
+// the model was saved. The stopwords must be the ones of the training
+// run, or the documents would be tokenized differently. The hash index is
+// checked, so a damaged file can not send a lookup out of the arrays, or
+// into an endless search. On failure, the model is left empty, and so is
+// the vocabulary, even if some of the words were already added.
+bool Model::Load(std::string path, Vocabulary &vocabulary) {
+
+  if ( vocabulary.Size() != 1 ) {
+    std::cout << "\tError: The model must be loaded before any document.";
+    std::cout << std::endl;
+    Clear();
+    return false;
+  }
+
+  bool return_value = reader.Open(path);
+
+  const char *stopwords = nullptr;
+  size_t stopwords_size = 0;
+  if ( return_value == true &&
+      reader.ReadArray(stopwords, stopwords_size) == true &&
+      std::string_view(stopwords, stopwords_size) != GetStopWords() ) {
+    std::cout << "\tError: The model " << path << " was trained with other";
+    std::cout << " stopwords. Give the stopwords file of the training run.";
+    std::cout << std::endl;
+    Clear();
+    return false;
+  }
+
+  const char *words = nullptr;
+  const uint64_t *word_offsets = nullptr;
+  size_t words_size = 0, word_offsets_size = 0, good_size = 0;
+  size_t bad_size = 0, tags_size = 0;
+  return_value = return_value && reader.ReadArray(words, words_size) &&
+      reader.ReadArray(word_offsets, word_offsets_size) &&
+      reader.ReadArray(term_slots, term_capacity) &&
+      reader.ReadArray(good_vector, good_size) &&
+      reader.ReadArray(bad_vector, bad_size) &&
+      reader.ReadArray(tag_scores, tags_size) &&
+      knn_training_set.Load(reader);
+
+  terms = good_size;
+  return_value = return_value && bad_size == terms && tags_size == terms &&
+      knn_training_set.GetTermsSize() == terms && terms < term_capacity &&
+      (term_capacity & (term_capacity - 1)) == 0;
+
+  return_value = return_value && word_offsets_size > 0 &&
+      word_offsets[0] == 0 && word_offsets[word_offsets_size - 1] ==
+      words_size;
+  for ( size_t id = 1; return_value == true && id < word_offsets_size;
+      id++ ) {
+    return_value = word_offsets[id - 1] <= word_offsets[id] &&
+        word_offsets[id] <= words_size &&
+        vocabulary.Intern(std::string_view(words + word_offsets[id - 1],
+            word_offsets[id] - word_offsets[id - 1])) == id;
+  }
+
+  // Every order must be given to exactly one term.
+  std::vector<bool> found_orders(return_value == true ? terms : 0, false);
+  size_t found_terms = 0;
+  for ( size_t slot = 0; return_value == true && slot < term_capacity;
+      slot++ ) {
+    if ( term_slots[slot].key == 0 ) {
+      continue;
+    }
+    size_t order = term_slots[slot].order;
+    return_value = order < terms && found_orders[order] == false;
+    if ( return_value == true ) {
+      found_orders[order] = true;
+      found_terms++;
+    }
+  }
+  return_value = return_value && found_terms == terms;
+
+  if ( return_value == false ) {
+    std::cout << "\tError: Could not read the model file " << path;
+    std::cout << std::endl;
+    Clear();
+    vocabulary.Clear();
+    return false;
+  }
+
+  return true;
+}
+
+// Drops every array, and the mapped model file they may point into.
+void Model::Clear() {
+  terms = 0;
+  term_slots = nullptr;
+  term_capacity = 0;
+  good_vector = nullptr;
+  bad_vector = nullptr;
+  tag_scores = nullptr;
+  built_term_slots.clear();
+  built_good_vector.clear();
+  built_bad_vector.clear();
+  built_tag_scores.clear();
+  knn_training_set.Clear();
+  reader.Close();
+}
+
+// Follows the cells from the home of the term, until the term or an
+// empty cell is found.
+const TermSlot *Model::FindTerm(TermKey term) const {
+  size_t slot = TermHome(term, term_capacity);
+  while ( term_slots[slot].key != 0 ) {
+    if ( term_slots[slot].key == term ) {
+      return &term_slots[slot];
+    }
+    slot = (slot + 1) & (term_capacity - 1);
+  }
+  return nullptr;
+}
+
+size_t Model::GetTermsSize() const {
+  return terms;
+}
+
+const float *Model::GetGoodVector() const {
+  return good_vector;
+}
+
+const float *Model::GetBadVector() const {
+  return bad_vector;
+}
+
+const float *Model::GetTagScores() const {
+  return tag_scores;
+}
+
+const KNNTrainingSet &Model::GetKNNTrainingSet() const {
+  return knn_training_set;
+}
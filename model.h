@@ -0,0 +1,90 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "trainingstats.h"
+#include "knntrainingset.h"
+#include "modelfile.h"
+#include "vocabulary.h"
+
+#include <string>
+#include <vector>
+
+// A cell of the frozen hash index of the term_set. An empty cell has the
+// key 0, which no term has, as the empty word is never part of a term.
+struct TermSlot {
+  TermKey key;
+  uint32_t order;
+  float nidf;
+};
+
+// The trained state of the methods, which the methods classify the testing
+// documents with. It is either built from the training statistics, or read
+// from a model file written by a previous run, which skips the training
+// documents altogether. A model file holds the stopwords of the training
+// run, which a model is only loaded with, every word of the vocabulary,
+// in the order of their IDs, so the testing documents read after it get
+// the same IDs as on the training run, the term_set with the order and
+// the nidf of every term, the good(bad)_vector of the means method, the
+// tag_scores of the tags method, and the vectors of the knn method.
+// Every array is stored as it is used, so a loaded model maps the file
+// read-only and uses the arrays in place, and every process that loads
+// the same file shares its pages.
+class Model {
+public:
+  Model();
+  ~Model();
+
+  Model(const Model &) = delete;
+  Model &operator=(const Model &) = delete;
+
+  bool Build(const TrainingStats &stats, bool means, bool tags, bool knn);
+  bool Save(std::string path, const Vocabulary &vocabulary) const;
+  bool Load(std::string path, Vocabulary &vocabulary);
+
+  const TermSlot *FindTerm(TermKey term) const;
+  size_t GetTermsSize() const;
+  const float *GetGoodVector() const;
+  const float *GetBadVector() const;
+  const float *GetTagScores() const;
+  const KNNTrainingSet &GetKNNTrainingSet() const;
+
+private:
+  void CreateTermIndex(const TrainingStats &stats);
+  void CreateMeansVectors(const TrainingStats &stats);
+  void CreateTagScores(const TrainingStats &stats);
+  void Clear();
+
+  // The number of terms in the term_set.
+  size_t terms = 0;
+
+  // The term_set as an open addressing hash index with linear probing.
+  // The capacity is a power of two, at least twice the terms, so there
+  // is always an empty cell that ends a search.
+  const TermSlot *term_slots = nullptr;
+  size_t term_capacity = 0;
+
+  // The good (bad) vector has size the size of the term_set, and contains
+  // the weight for every term, related to the good (bad) documents.
+  const float *good_vector = nullptr;
+  const float *bad_vector = nullptr;
+
+  // Stores a float value for every term of the term_set, in the cell
+  // indicated by the term's order, indicating the score of the term.
+  // Positive value means that the term is positive, negative value
+  // means the term is negative. The higher the absolute value, the more the
+  // weight of the term.
+  const float *tag_scores = nullptr;
+
+  // The arrays built from the training statistics, or the mapped model
+  // file the arrays point into.
+  std::vector<TermSlot> built_term_slots;
+  std::vector<float> built_good_vector;
+  std::vector<float> built_bad_vector;
+  std::vector<float> built_tag_scores;
+  ModelReader reader;
+
+  // The vectors of the training documents, shared by every knn search.
+  KNNTrainingSet knn_training_set;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "modelfile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// The first bytes of every model file, followed by the version and a
+// value that reads differently on a machine with another byte order.
+static const char model_magic[8] = {'O', 'M', 'M', 'O', 'D', 'E', 'L', 0};
+static const uint32_t byte_order = 0x01020304;
+
+// The header is rewritten by Close(), once the table is written.
+static ModelHeader MakeHeader(uint64_t table_offset, uint64_t sections) {
+  ModelHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, model_magic, sizeof(model_magic));
+  header.version = model_version;
+  header.byte_order = byte_order;
+  header.table_offset = table_offset;
+  header.sections = sections;
+  return header;
+}
+
+ModelWriter::ModelWriter() {}
+
+ModelWriter::~ModelWriter() {}
+
+// The model is written in a temporary file next to the path, which only
+// replaces the file at the path once it is complete. A process that has
+// mapped the old file keeps reading it as it was.
+bool ModelWriter::Open(std::string path) {
+  final_path = path;
+  temp_path = path + ".tmp";
+  file.open(temp_path, std::ios_base::binary | std::ios_base::trunc);
+  if ( file.is_open() == false ) {
+    return false;
+  }
+
+  table.clear();
+  ModelHeader header = MakeHeader(0, 0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  position = sizeof(header);
+  return file.good();
+}
+
+// Pads the file up to the alignment, and writes the bytes as the next
+// section.
+void ModelWriter::WriteBytes(const void *bytes, size_t size) {
+  static const char padding[model_alignment] = {0};
+  size_t pad = (model_alignment - position % model_alignment) %
+      model_alignment;
+  file.write(padding, pad);
+  position += pad;
+
+  ModelSection section;
+  section.offset = position;
+  section.size = size;
+  table.push_back(section);
+
+  file.write(static_cast<const char*>(bytes), size);
+  position += size;
+}
+
+bool ModelWriter::Close() {
+  if ( file.is_open() == false ) {
+    return false;
+  }
+
+  // The table is aligned like the sections, so it can be used in place.
+  static const char padding[model_alignment] = {0};
+  size_t pad = (model_alignment - position % model_alignment) %
+      model_alignment;
+  file.write(padding, pad);
+  position += pad;
+
+  file.write(reinterpret_cast<const char*>(table.data()),
+      table.size() * sizeof(ModelSection));
+
+  ModelHeader header = MakeHeader(position, table.size());
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  file.close();
+  if ( file.good() == false || rename(temp_path.c_str(),
+        final_path.c_str()) != 0 ) {
+    remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+ModelReader::ModelReader() {}
+
+ModelReader::~ModelReader() {}
+
+bool ModelReader::Open(std::string path) {
+
+  Close();
+
+  if ( mapping.OpenReadOnly(path) == false ||
+      mapping.Size() < sizeof(ModelHeader) ) {
+    failed = true;
+    return false;
+  }
+
+  const char *data = mapping.Data();
+  size_t size = mapping.Size();
+
+  ModelHeader header;
+  memcpy(&header, data, sizeof(header));
+  if ( memcmp(header.magic, model_magic, sizeof(model_magic)) != 0 ||
+      header.version != model_version || header.byte_order != byte_order ||
+      header.table_offset % model_alignment != 0 ||
+      header.table_offset > size ||
+      header.sections > (size - header.table_offset) / sizeof(ModelSection) ) {
+    failed = true;
+    return false;
+  }
+
+  table = reinterpret_cast<const ModelSection*>(data + header.table_offset);
+  sections = header.sections;
+
+  for ( size_t i = 0; i < sections; i++ ) {
+    if ( table[i].offset % model_alignment != 0 || table[i].offset > size ||
+        table[i].size > size - table[i].offset ) {
+      failed = true;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ModelReader::Close() {
+  mapping.Close();
+  table = nullptr;
+  sections = 0;
+  next_section = 0;
+  failed = false;
+}
+
+bool ModelReader::Failed() const {
+  return failed;
+}
+
+bool ModelReader::ReadBytes(const char *&bytes, size_t &size) {
+  if ( failed == true || next_section >= sections ) {
+    failed = true;
+    return false;
+  }
+
+  const ModelSection &section = table[next_section++];
+  bytes = mapping.Data() + section.offset;
+  size = section.size;
+  return true;
+}
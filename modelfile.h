@@ -0,0 +1,120 @@
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include "mappedfile.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// The version of the model files. Files written with another version, or
+// on a machine with another byte order, are refused.
+const uint32_t model_version = 3;
+
+// Every section of a model file starts on a multiple of this many bytes,
+// so the arrays can be used in place, and do not share cache lines.
+const size_t model_alignment = 64;
+
+// A model file is a header, followed by its sections, and the table of
+// the sections at the end. Every offset is counted from the start of the
+// file, so the file can be mapped at any address and used as it is.
+struct ModelHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t table_offset;
+  uint64_t sections;
+};
+
+struct ModelSection {
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Writes the sections of a model file one after another, in the byte
+// order of the machine. A value is written as a section of its own. Every
+// write after a failed one is skipped, so the caller only checks Close()
+// at the end, which writes the table of the sections.
+class ModelWriter {
+public:
+  ModelWriter();
+  ~ModelWriter();
+
+  bool Open(std::string path);
+  bool Close();
+
+  template <typename T> void Write(const T &value) {
+    WriteBytes(&value, sizeof(T));
+  }
+
+  template <typename T> void WriteArray(const T *values, size_t size) {
+    WriteBytes(values, size * sizeof(T));
+  }
+
+  template <typename T> void WriteArray(const std::vector<T> &values) {
+    WriteArray(values.data(), values.size());
+  }
+
+private:
+  void WriteBytes(const void *bytes, size_t size);
+
+  std::ofstream file;
+  std::string final_path;
+  std::string temp_path;
+  uint64_t position = 0;
+  std::vector<ModelSection> table;
+};
+
+// Maps a model file read-only and gives the sections back in the order
+// they were written, as pointers in the mapping, without copying them.
+// The header and the table are checked when the file is opened, so every
+// section lies inside the file and is aligned. The pointers must not
+// outlive the reader. Every read after a failed one fails.
+class ModelReader {
+public:
+  ModelReader();
+  ~ModelReader();
+
+  ModelReader(const ModelReader &) = delete;
+  ModelReader &operator=(const ModelReader &) = delete;
+
+  bool Open(std::string path);
+  void Close();
+  bool Failed() const;
+
+  template <typename T> bool Read(T &value) {
+    const T *values = nullptr;
+    size_t size = 0;
+    if ( ReadArray(values, size) == false || size != 1 ) {
+      failed = true;
+      return false;
+    }
+    value = values[0];
+    return true;
+  }
+
+  template <typename T> bool ReadArray(const T *&values, size_t &size) {
+    const char *bytes = nullptr;
+    size_t bytes_size = 0;
+    if ( ReadBytes(bytes, bytes_size) == false ||
+        bytes_size % sizeof(T) != 0 ) {
+      failed = true;
+      return false;
+    }
+    values = reinterpret_cast<const T*>(bytes);
+    size = bytes_size / sizeof(T);
+    return true;
+  }
+
+private:
+  bool ReadBytes(const char *&bytes, size_t &size);
+
+  MappedFile mapping;
+  const ModelSection *table = nullptr;
+  size_t sections = 0;
+  size_t next_section = 0;
+  bool failed = false;
+};
+
+#endif
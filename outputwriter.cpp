@@ -0,0 +1,158 @@
+#include "outputwriter.h"
+
+#include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+OutputWriter::OutputWriter(bool background, size_t bytes) {
+  queue_bytes = bytes > 0 ? bytes : 1;
+
+  if ( background == true ) {
+    flusher = std::thread(&OutputWriter::Flush, this);
+  }
+}
+
+OutputWriter::~OutputWriter() {
+  Finish();
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  job_ready.notify_all();
+
+  if ( flusher.joinable() ) {
+    flusher.join();
+  }
+}
+
+// Writes the buffer in the file, truncating the file first, unless append
+// is set. Without a flush thread, the buffer is written right away, and
+// the result is known on return. With the flush thread, the buffer is
+// queued, waiting for space in the queue if it is full, and only a
+// previous failure is reported.
+bool OutputWriter::Write(std::string path, std::string &&buffer,
+  bool append) {
+
+  Job job;
+  job.path = path;
+  job.buffer.swap(buffer);
+  job.append = append;
+
+  if ( flusher.joinable() == false ) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if ( failed == true ) {
+        return false;
+      }
+    }
+
+    if ( WriteFile(job) == false ) {
+      std::unique_lock<std::mutex> lock(mutex);
+      failed = true;
+      return false;
+    }
+    return true;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // A buffer larger than the whole queue waits for the queue to empty.
+    job_space.wait(lock, [this, &job] {
+      return failed || queued_bytes == 0 ||
+          queued_bytes + job.buffer.size() <= queue_bytes;
+    });
+    if ( failed == true ) {
+      return false;
+    }
+
+    queued_bytes += job.buffer.size();
+    jobs.push_back(std::move(job));
+  }
+  job_ready.notify_one();
+
+  return true;
+}
+
+// Waits until every queued buffer is written, and returns whether every
+// buffer was written successfully.
+bool OutputWriter::Finish() {
+  std::unique_lock<std::mutex> lock(mutex);
+  all_written.wait(lock, [this] { return jobs.empty() && !writing; });
+  return failed == false;
+}
+
+// The flush thread writes the oldest buffer of the queue, until the writer
+// is destroyed. After a failure, the queued buffers are dropped.
+void OutputWriter::Flush() {
+  while ( true ) {
+
+    Job job;
+    bool skip;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if ( jobs.empty() ) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      writing = true;
+      skip = failed;
+    }
+
+    bool succeeded = skip == false && WriteFile(job);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queued_bytes -= job.buffer.size();
+      writing = false;
+      if ( succeeded == false ) {
+        failed = true;
+      }
+      if ( jobs.empty() ) {
+        all_written.notify_all();
+      }
+    }
+    job_space.notify_all();
+  }
+}
+
+// Writes the whole buffer with as few system calls as the kernel allows.
+bool OutputWriter::WriteFile(const Job &job) {
+
+  int flags = O_WRONLY | O_CREAT | (job.append ? O_APPEND : O_TRUNC);
+  int fd = open(job.path.c_str(), flags, 0644);
+  if ( fd < 0 ) {
+    std::cout << "\nError: Could not open output file ";
+    std::cout << job.path << std::endl;
+    return false;
+  }
+
+  const char *data = job.buffer.data();
+  size_t left = job.buffer.size();
+  while ( left > 0 ) {
+    ssize_t written = write(fd, data, left);
+    if ( written < 0 && errno == EINTR ) {
+      continue;
+    }
+    if ( written <= 0 ) {
+      std::cout << "\nError: Could not write output file ";
+      std::cout << job.path << std::endl;
+      close(fd);
+      return false;
+    }
+    data += written;
+    left -= written;
+  }
+
+  if ( close(fd) != 0 ) {
+    std::cout << "\nError: Could not write output file ";
+    std::cout << job.path << std::endl;
+    return false;
+  }
+
+  return true;
+}
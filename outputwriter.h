@@ -0,0 +1,62 @@
+#ifndef OUTPUTWRITER_H
+#define OUTPUTWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// The size of the buffers the output is gathered in, before it is handed
+// to the writer.
+const size_t output_buffer_size = 1024 * 1024;
+
+// Writes whole buffers in files, each with a single open, write and close,
+// instead of a stream opened for every line or written word by word. The
+// buffers are written either right away, on the calling thread, or by a
+// background flush thread, so the callers go on with their work while the
+// buffers are written. The queue of the flush thread holds at most
+// queue_bytes bytes, and a buffer waits while the queue is full, so the
+// callers can never get too far ahead of the disk. Buffers of the same
+// file are written in the order they were given. Any number of threads
+// can give buffers at the same time. Once a buffer could not be written,
+// every following buffer is dropped, and Finish() fails.
+class OutputWriter {
+public:
+  OutputWriter(bool background, size_t queue_bytes = 64 * 1024 * 1024);
+  ~OutputWriter();
+
+  OutputWriter(const OutputWriter &) = delete;
+  OutputWriter &operator=(const OutputWriter &) = delete;
+
+  bool Write(std::string path, std::string &&buffer, bool append);
+  bool Finish();
+
+private:
+  // A buffer waiting for the flush thread.
+  struct Job {
+    std::string path;
+    std::string buffer;
+    bool append;
+  };
+
+  void Flush();
+  bool WriteFile(const Job &job);
+
+  std::thread flusher;
+  std::deque<Job> jobs;
+  size_t queue_bytes;
+  size_t queued_bytes = 0;
+
+  // Whether the flush thread is writing a buffer it took from the queue.
+  bool writing = false;
+  bool stopping = false;
+  bool failed = false;
+
+  std::mutex mutex;
+  std::condition_variable job_ready;
+  std::condition_variable job_space;
+  std::condition_variable all_written;
+};
+
+#endif
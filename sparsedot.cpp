@@ -0,0 +1,212 @@
+#include "sparsedot.h"
+
+#include <immintrin.h>
+#include <nmmintrin.h>
+
+typedef SparseDotKernel DotKernel;
+
+// Walks the two vectors side by side from the terms i and j, adding the
+// products of the common terms to nom. Every step moves past the smaller
+// term, or both terms when they are equal, without branching on which.
+static inline float MergeScalar(const uint32_t *ids_a, const float *weights_a,
+  size_t length_a, const uint32_t *ids_b, const float *weights_b,
+  size_t length_b, size_t i, size_t j, float nom) {
+
+  while ( i < length_a && j < length_b ) {
+    uint32_t id_a = ids_a[i];
+    uint32_t id_b = ids_b[j];
+    if ( id_a == id_b ) {
+      nom += weights_a[i] * weights_b[j];
+    }
+    i += id_a <= id_b;
+    j += id_b <= id_a;
+  }
+  return nom;
+}
+
+static float DotScalar(const uint32_t *ids_a, const float *weights_a,
+  size_t length_a, const uint32_t *ids_b, const float *weights_b,
+  size_t length_b) {
+  return MergeScalar(ids_a, weights_a, length_a, ids_b, weights_b, length_b,
+      0, 0, 0);
+}
+
+// The SIMD kernels compare a block of terms of each vector, every term of
+// one block with every term of the other, by rotating the second block one
+// lane at a time. A term of the first block matches at most one rotation,
+// which gives the position of the term it matches in the second block.
+// The block with the smaller last term is moved past, or both blocks when
+// their last terms are equal, so every common term is found exactly once,
+// and in ascending order.
+
+__attribute__((target("sse4.2")))
+static float DotSSE42(const uint32_t *ids_a, const float *weights_a,
+  size_t length_a, const uint32_t *ids_b, const float *weights_b,
+  size_t length_b) {
+
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  const __m128i three = _mm_set1_epi32(3);
+
+  float nom = 0;
+  size_t i = 0, j = 0;
+  while ( i + 4 <= length_a && j + 4 <= length_b ) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ids_a + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ids_b + j));
+
+    // The lane l of the rotation r holds the term (l + r) % 4 of b.
+    __m128i equal0 = _mm_cmpeq_epi32(a, b);
+    __m128i equal1 = _mm_cmpeq_epi32(a,
+        _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1)));
+    __m128i equal2 = _mm_cmpeq_epi32(a,
+        _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128i equal3 = _mm_cmpeq_epi32(a,
+        _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3)));
+
+    __m128i equal = _mm_or_si128(_mm_or_si128(equal0, equal1),
+        _mm_or_si128(equal2, equal3));
+    unsigned int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+
+    if ( mask != 0 ) {
+      __m128i rotations = _mm_or_si128(_mm_and_si128(equal1, one),
+          _mm_or_si128(_mm_and_si128(equal2, two),
+            _mm_and_si128(equal3, three)));
+      uint32_t rotation[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(rotation), rotations);
+
+      while ( mask != 0 ) {
+        unsigned int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        nom += weights_a[i + lane] *
+            weights_b[j + ((lane + rotation[lane]) & 3)];
+      }
+    }
+
+    uint32_t last_a = ids_a[i + 3];
+    uint32_t last_b = ids_b[j + 3];
+    i += (last_a <= last_b) * 4;
+    j += (last_b <= last_a) * 4;
+  }
+
+  return MergeScalar(ids_a, weights_a, length_a, ids_b, weights_b, length_b,
+      i, j, nom);
+}
+
+// Rotates the terms inside both halves of a block of 8 terms, the lane l
+// of a half getting the term (l + R) % 4 of the half.
+#define ROTATE_HALVES(ids, R) _mm256_shuffle_epi32(ids, \
+    _MM_SHUFFLE((R + 3) & 3, (R + 2) & 3, (R + 1) & 3, R & 3))
+
+__attribute__((target("avx2")))
+static float DotAVX2(const uint32_t *ids_a, const float *weights_a,
+  size_t length_a, const uint32_t *ids_b, const float *weights_b,
+  size_t length_b) {
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256i four = _mm256_set1_epi32(4);
+
+  float nom = 0;
+  size_t i = 0, j = 0;
+  while ( i + 8 <= length_a && j + 8 <= length_b ) {
+    __m256i a = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(ids_a + i));
+    __m256i b = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(ids_b + j));
+
+    // Rotating inside the halves of b, and of b with its halves swapped,
+    // compares every term of a with every term of b.
+    __m256i swapped = _mm256_permute2x128_si256(b, b, 1);
+    __m256i equal0 = _mm256_cmpeq_epi32(a, b);
+    __m256i equal1 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(b, 1));
+    __m256i equal2 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(b, 2));
+    __m256i equal3 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(b, 3));
+    __m256i equal4 = _mm256_cmpeq_epi32(a, swapped);
+    __m256i equal5 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(swapped, 1));
+    __m256i equal6 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(swapped, 2));
+    __m256i equal7 = _mm256_cmpeq_epi32(a, ROTATE_HALVES(swapped, 3));
+
+    __m256i rotated = _mm256_or_si256(
+        _mm256_or_si256(equal1, equal5), _mm256_or_si256(equal3, equal7));
+    __m256i rotated2 = _mm256_or_si256(
+        _mm256_or_si256(equal2, equal6), _mm256_or_si256(equal3, equal7));
+    __m256i halves = _mm256_or_si256(
+        _mm256_or_si256(equal4, equal5), _mm256_or_si256(equal6, equal7));
+    __m256i equal = _mm256_or_si256(
+        _mm256_or_si256(equal0, equal2), _mm256_or_si256(rotated, halves));
+    unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+
+    if ( mask != 0 ) {
+
+      // The rotation matched by every lane, plus 4 if it matched in the
+      // other half of b.
+      __m256i rotations = _mm256_or_si256(
+          _mm256_or_si256(_mm256_and_si256(rotated, one),
+            _mm256_and_si256(rotated2, two)),
+          _mm256_and_si256(halves, four));
+      uint32_t rotation[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(rotation), rotations);
+
+      while ( mask != 0 ) {
+        unsigned int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        size_t matched = ((lane & 4) | ((lane + rotation[lane]) & 3)) ^
+            (rotation[lane] & 4);
+        nom += weights_a[i + lane] * weights_b[j + matched];
+      }
+    }
+
+    uint32_t last_a = ids_a[i + 7];
+    uint32_t last_b = ids_b[j + 7];
+    i += (last_a <= last_b) * 8;
+    j += (last_b <= last_a) * 8;
+  }
+
+  return MergeScalar(ids_a, weights_a, length_a, ids_b, weights_b, length_b,
+      i, j, nom);
+}
+
+static DotKernel kernel = DotScalar;
+static const char *kernel_name = "scalar";
+
+void InitSparseDot() {
+  DotKernel best = DotScalar;
+  const char *best_name = "scalar";
+  if ( __builtin_cpu_supports("avx2") ) {
+    best = DotAVX2;
+    best_name = "avx2";
+  }
+  else if ( __builtin_cpu_supports("sse4.2") ) {
+    best = DotSSE42;
+    best_name = "sse4.2";
+  }
+
+  // A later call picks the same kernel, and changes nothing, so it is
+  // safe while other threads are intersecting vectors.
+  if ( kernel != best ) {
+    kernel = best;
+    kernel_name = best_name;
+  }
+}
+
+float SparseDot(const uint32_t *ids_a, const float *weights_a,
+  size_t length_a, const uint32_t *ids_b, const float *weights_b,
+  size_t length_b) {
+  return kernel(ids_a, weights_a, length_a, ids_b, weights_b, length_b);
+}
+
+const char *GetSparseDotKernel() {
+  return kernel_name;
+}
+
+std::vector<NamedSparseDotKernel> GetSparseDotKernels() {
+  std::vector<NamedSparseDotKernel> kernels;
+  kernels.push_back({"scalar", DotScalar});
+  if ( __builtin_cpu_supports("sse4.2") ) {
+    kernels.push_back({"sse4.2", DotSSE42});
+  }
+  if ( __builtin_cpu_supports("avx2") ) {
+    kernels.push_back({"avx2", DotAVX2});
+  }
+  return kernels;
+}
@@ -0,0 +1,39 @@
+#ifndef SPARSEDOT_H
+#define SPARSEDOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Picks the fastest kernel the processor supports for the dot products of
+// the sparse vectors: AVX2, then SSE4.2, then the scalar fallback. Can be
+// called any number of times; the scalar kernel is used until it is.
+void InitSparseDot();
+
+// The dot product of two sparse vectors, given as their term IDs sorted in
+// ascending order, along with the weight of every term. The products of
+// the common terms are added up in the order of the terms, each product
+// rounded before it is added, so every kernel gives exactly the same sum
+// as the scalar kernel. Allocates nothing.
+float SparseDot(const uint32_t *ids_a, const float *weights_a,
+    size_t length_a, const uint32_t *ids_b, const float *weights_b,
+    size_t length_b);
+
+// The name of the kernel picked by InitSparseDot().
+const char *GetSparseDotKernel();
+
+// A kernel of SparseDot(), and its name.
+typedef float (*SparseDotKernel)(const uint32_t *ids_a,
+    const float *weights_a, size_t length_a, const uint32_t *ids_b,
+    const float *weights_b, size_t length_b);
+struct NamedSparseDotKernel {
+  const char *name;
+  SparseDotKernel kernel;
+};
+
+// Every kernel the processor supports, the scalar kernel first, so the
+// kernels can be checked against each other.
+std::vector<NamedSparseDotKernel> GetSparseDotKernels();
+
+#endif
@@ -0,0 +1,154 @@
+// Checks that every sparse dot kernel gives bit for bit the same sums as
+// the scalar kernel, on random vectors of sorted term IDs, and times each
+// of them against a hash map lookup of the common terms. Built and run by
+// "make check"; exits with 1 when a kernel differs.
+
+#include "sparsedot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// A random sparse vector, its term IDs sorted in ascending order.
+struct SparseVector {
+  std::vector<uint32_t> ids;
+  std::vector<float> weights;
+};
+
+static SparseVector RandomVector(std::mt19937 &random, uint32_t max_id,
+  size_t max_terms) {
+
+  std::uniform_int_distribution<size_t> length(0, max_terms);
+  std::uniform_int_distribution<uint32_t> id(0, max_id - 1);
+  std::uniform_real_distribution<float> weight(-4, 4);
+
+  SparseVector vector;
+  size_t terms = std::min<size_t>(length(random), max_id);
+  while ( vector.ids.size() < terms ) {
+    while ( vector.ids.size() < terms ) {
+      vector.ids.push_back(id(random));
+    }
+    std::sort(vector.ids.begin(), vector.ids.end());
+    vector.ids.erase(std::unique(vector.ids.begin(), vector.ids.end()),
+        vector.ids.end());
+  }
+  for ( size_t i = 0; i < vector.ids.size(); i++ ) {
+    vector.weights.push_back(weight(random));
+  }
+  return vector;
+}
+
+static float HashDot(const std::unordered_map<uint32_t, float> &map_a,
+  const SparseVector &b) {
+
+  float nom = 0;
+  for ( size_t j = 0; j < b.ids.size(); j++ ) {
+    auto found = map_a.find(b.ids[j]);
+    if ( found != map_a.end() ) {
+      nom += found->second * b.weights[j];
+    }
+  }
+  return nom;
+}
+
+static uint32_t Bits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+int main() {
+  std::mt19937 random(20260419);
+
+  // Small ID ranges give many common terms, large ones almost none.
+  const uint32_t max_ids[] = { 16, 256, 4096, 50000 };
+  const size_t max_terms[] = { 3, 20, 200, 2000 };
+  const size_t pairs_per_case = 2000;
+
+  std::vector<NamedSparseDotKernel> kernels = GetSparseDotKernels();
+  size_t checked = 0;
+  size_t mismatches = 0;
+
+  for ( uint32_t max_id : max_ids ) {
+    for ( size_t terms : max_terms ) {
+      for ( size_t pair = 0; pair < pairs_per_case; pair++ ) {
+        SparseVector a = RandomVector(random, max_id, terms);
+        SparseVector b = RandomVector(random, max_id, terms);
+        float expected = kernels[0].kernel(a.ids.data(), a.weights.data(),
+            a.ids.size(), b.ids.data(), b.weights.data(), b.ids.size());
+
+        for ( size_t k = 1; k < kernels.size(); k++ ) {
+          float sum = kernels[k].kernel(a.ids.data(), a.weights.data(),
+              a.ids.size(), b.ids.data(), b.weights.data(), b.ids.size());
+          if ( Bits(sum) != Bits(expected) ) {
+            if ( mismatches < 10 ) {
+              std::cout << "\tError: " << kernels[k].name << " gives " << sum;
+              std::cout << " instead of " << expected << " (" << a.ids.size();
+              std::cout << " and " << b.ids.size() << " terms, ids below ";
+              std::cout << max_id << ")" << std::endl;
+            }
+            mismatches++;
+          }
+          checked++;
+        }
+      }
+    }
+  }
+
+  std::cout << "Compared " << checked << " sums of " << kernels.size() - 1;
+  std::cout << " kernels with the scalar kernel: " << mismatches;
+  std::cout << " differ" << std::endl;
+
+  // The timings use the vectors of the measurement in the commit of the
+  // kernels: ids below 50000, up to 200 terms.
+  const size_t vectors = 1000;
+  const size_t rounds = 900;
+  std::vector<SparseVector> as;
+  std::vector<SparseVector> bs;
+  std::vector<std::unordered_map<uint32_t, float>> maps;
+  for ( size_t i = 0; i < vectors; i++ ) {
+    as.push_back(RandomVector(random, 50000, 200));
+    bs.push_back(RandomVector(random, 50000, 200));
+    std::unordered_map<uint32_t, float> map;
+    for ( size_t j = 0; j < as[i].ids.size(); j++ ) {
+      map[as[i].ids[j]] = as[i].weights[j];
+    }
+    maps.push_back(std::move(map));
+  }
+
+  std::cout << "Time of " << vectors * rounds << " vector pairs:" << std::endl;
+
+  // The sums are added up, so the calls are not optimized away.
+  float total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for ( size_t round = 0; round < rounds; round++ ) {
+    for ( size_t i = 0; i < vectors; i++ ) {
+      total += HashDot(maps[i], bs[(i + round) % vectors]);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "\thash map: " << std::chrono::duration_cast<
+    std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+
+  for ( const NamedSparseDotKernel &kernel : kernels ) {
+    start = std::chrono::steady_clock::now();
+    for ( size_t round = 0; round < rounds; round++ ) {
+      for ( size_t i = 0; i < vectors; i++ ) {
+        const SparseVector &a = as[i];
+        const SparseVector &b = bs[(i + round) % vectors];
+        total += kernel.kernel(a.ids.data(), a.weights.data(), a.ids.size(),
+            b.ids.data(), b.weights.data(), b.ids.size());
+      }
+    }
+    end = std::chrono::steady_clock::now();
+    std::cout << "\t" << kernel.name << ": " << std::chrono::duration_cast<
+      std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+  }
+  std::cout << "\t(checksum " << total << ")" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include "stopwords.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+// Common words. If any of these words are found in the raw
+// documents, while parsing them, they will be discarded.
+const size_t commons_size = 28;
+constexpr std::string_view commons[commons_size] = {
+  "the", "to", "of", "and", "a", "an", "that", "in",
+  "it", "with", "as", "do", "there", "they", "we",
+  "she", "he", "or", "will", "one", "this", "by", "so",
+  "just", "i", "for", "these", "them"
+};
+
+// The FNV-1a hash of the word, starting from the seed.
+static constexpr uint64_t HashWord(std::string_view word, uint64_t seed) {
+  uint64_t hash = 14695981039346656037ULL ^ seed;
+  for ( size_t i = 0; i < word.size(); i++ ) {
+    hash ^= static_cast<unsigned char>(word[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The table of the common words. Built at compile time by trying seeds
+// until every word gets its own slot.
+const size_t commons_slots_size = 128;
+
+struct CommonsTable {
+  std::string_view slots[commons_slots_size];
+  uint64_t seed;
+};
+
+static constexpr CommonsTable BuildCommonsTable() {
+  for ( uint64_t seed = 0; ; seed++ ) {
+    CommonsTable table{};
+    table.seed = seed;
+
+    bool perfect = true;
+    for ( size_t i = 0; i < commons_size && perfect; i++ ) {
+      size_t slot = HashWord(commons[i], seed) & (commons_slots_size - 1);
+      if ( table.slots[slot].empty() == false ) {
+        perfect = false;
+      }
+      table.slots[slot] = commons[i];
+    }
+
+    if ( perfect == true ) {
+      return table;
+    }
+  }
+}
+
+static constexpr CommonsTable commons_table = BuildCommonsTable();
+
+StopWords::StopWords() {
+  slots = commons_table.slots;
+  slots_mask = commons_slots_size - 1;
+  seed = commons_table.seed;
+  size = commons_size;
+}
+
+StopWords::~StopWords() {}
+
+// Replaces the stopwords with the words of a file, one word per line.
+// The words are made lowercase, and empty lines are skipped.
+bool StopWords::Load(std::string path) {
+
+  std::ifstream input_file(path);
+  if ( input_file.is_open() == false ) {
+    std::cout << "Error: Could not open stopwords file " << path;
+    std::cout << std::endl;
+    return false;
+  }
+
+  loaded_words.clear();
+  std::string line;
+  while ( getline(input_file, line) ) {
+
+    // Remove the spaces around the word.
+    size_t start = line.find_first_not_of(" \t\r");
+    if ( start == std::string::npos ) {
+      continue;
+    }
+    size_t end = line.find_last_not_of(" \t\r");
+    std::string word = line.substr(start, end - start + 1);
+
+    for ( size_t i = 0; i < word.size(); i++ ) {
+      if ( word[i] >= 'A' && word[i] <= 'Z' ) {
+        word[i] += 'a' - 'A';
+      }
+    }
+    loaded_words.push_back(word);
+  }
+  input_file.close();
+
+  // Keep at most half of the slots in use, so the probes stay short.
+  size_t slots_size = commons_slots_size;
+  while ( slots_size < 2 * loaded_words.size() ) {
+    slots_size *= 2;
+  }
+
+  loaded_slots.assign(slots_size, std::string_view());
+  slots = loaded_slots.data();
+  slots_mask = slots_size - 1;
+  seed = 0;
+  size = 0;
+
+  for ( size_t i = 0; i < loaded_words.size(); i++ ) {
+    Insert(loaded_words.at(i));
+  }
+
+  return true;
+}
+
+// Adds a word in the loaded slots, moving to the next slot while the slot
+// is taken by another word.
+void StopWords::Insert(std::string_view word) {
+  size_t slot = HashWord(word, seed) & slots_mask;
+  while ( loaded_slots.at(slot).empty() == false ) {
+    if ( loaded_slots.at(slot) == word ) {
+      return;
+    }
+    slot = (slot + 1) & slots_mask;
+  }
+  loaded_slots.at(slot) = word;
+  size++;
+}
+
+bool StopWords::Contains(std::string_view word) const {
+  if ( word.empty() == true ) {
+    return false;
+  }
+
+  size_t slot = HashWord(word, seed) & slots_mask;
+  while ( slots[slot].empty() == false ) {
+    if ( slots[slot] == word ) {
+      return true;
+    }
+    slot = (slot + 1) & slots_mask;
+  }
+  return false;
+}
+
+size_t StopWords::Size() const {
+  return size;
+}
+
+// Every word of the table, sorted, each one followed by a line break, so
+// the same words always give the same text, whatever their slots.
+std::string StopWords::GetWords() const {
+  std::vector<std::string_view> words;
+  for ( size_t slot = 0; slot <= slots_mask; slot++ ) {
+    if ( slots[slot].empty() == false ) {
+      words.push_back(slots[slot]);
+    }
+  }
+  std::sort(words.begin(), words.end());
+
+  std::string text;
+  for ( size_t i = 0; i < words.size(); i++ ) {
+    text += words[i];
+    text += '\n';
+  }
+  return text;
+}
@@ -0,0 +1,43 @@
+#ifndef STOPWORDS_H
+#define STOPWORDS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+// The common words discarded from the raw documents, kept in an open
+// addressing hash table, so checking a word takes a single hash and
+// usually a single comparison. The default words are built in a table
+// at compile time, with a seed chosen so that no two words share a slot.
+// Larger lists can be loaded from a file at startup into a table of the
+// same kind. Words are compared after they are made lowercase.
+class StopWords {
+public:
+  StopWords();
+  ~StopWords();
+
+  StopWords(const StopWords &) = delete;
+  StopWords &operator=(const StopWords &) = delete;
+
+  bool Load(std::string path);
+  bool Contains(std::string_view word) const;
+  size_t Size() const;
+  std::string GetWords() const;
+
+private:
+  void Insert(std::string_view word);
+
+  // The slots of the table in use. Empty slots hold an empty word. The
+  // number of slots is a power of two.
+  const std::string_view *slots;
+  size_t slots_mask;
+  uint64_t seed;
+  size_t size;
+
+  // The words loaded from a file, and the slots of their table.
+  std::vector<std::string> loaded_words;
+  std::vector<std::string_view> loaded_slots;
+};
+
+#endif
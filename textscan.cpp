@@ -0,0 +1,170 @@
+#include "textscan.h"
+
+#include <immintrin.h>
+#include <nmmintrin.h>
+
+// Every kernel marks the delimiters and makes the letters lowercase in
+// the same pass, producing the same mask and text.
+typedef uint64_t (*ScanKernel)(char *block, size_t length);
+
+// Whether every byte value is a delimiter, used by the scalar kernel and
+// for the characters left at the end of a block.
+static bool is_delimiter[256];
+
+// The delimiters, padded with zeros, for the SSE4.2 string instructions.
+static __m128i sse_delimiters;
+static int sse_delimiters_size = 0;
+
+// The nibble tables of the AVX2 kernel. Every distinct high nibble of the
+// delimiters gets a bit. The low table holds, for every low nibble, the
+// bits of the high nibbles it forms a delimiter with, so a character is
+// a delimiter if low_table[low] & high_table[high] is not 0.
+static uint8_t low_table[16];
+static uint8_t high_table[16];
+
+static bool has_sse_kernel = false;
+static bool has_avx2_kernel = false;
+
+static uint64_t ScanScalar(char *block, size_t length) {
+  uint64_t mask = 0;
+  for ( size_t i = 0; i < length; i++ ) {
+    unsigned char c = block[i];
+    if ( is_delimiter[c] == true ) {
+      mask |= static_cast<uint64_t>(1) << i;
+    }
+    if ( c >= 'A' && c <= 'Z' ) {
+      block[i] = c + ('a' - 'A');
+    }
+  }
+  return mask;
+}
+
+// Makes the letters of 16 bytes lowercase. The comparisons are signed,
+// so bytes above 127 are never changed.
+__attribute__((target("sse4.2")))
+static inline __m128i LowercaseSSE(__m128i bytes) {
+  __m128i upper = _mm_and_si128(
+      _mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+      _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+  return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse4.2")))
+static uint64_t ScanSSE42(char *block, size_t length) {
+  const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+  uint64_t mask = 0;
+  size_t i = 0;
+  for ( ; i + 16 <= length; i += 16 ) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<__m128i*>(block + i));
+    __m128i found = _mm_cmpestrm(sse_delimiters, sse_delimiters_size,
+        bytes, 16, mode);
+    uint64_t bits = static_cast<uint32_t>(_mm_cvtsi128_si32(found)) & 0xFFFF;
+    mask |= bits << i;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(block + i),
+        LowercaseSSE(bytes));
+  }
+
+  if ( i < length ) {
+    mask |= ScanScalar(block + i, length - i) << i;
+  }
+  return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t ScanAVX2(char *block, size_t length) {
+  const __m256i low_nibbles = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(low_table)));
+  const __m256i high_nibbles = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(high_table)));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+  uint64_t mask = 0;
+  size_t i = 0;
+  for ( ; i + 32 <= length; i += 32 ) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<__m256i*>(block + i));
+
+    // Look up the bits of the low and high nibble of every byte.
+    __m256i low = _mm256_shuffle_epi8(low_nibbles,
+        _mm256_and_si256(bytes, nibble));
+    __m256i high = _mm256_shuffle_epi8(high_nibbles,
+        _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+    __m256i other = _mm256_cmpeq_epi8(_mm256_and_si256(low, high),
+        _mm256_setzero_si256());
+    uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_epi8(other));
+    mask |= static_cast<uint64_t>(bits) << i;
+
+    __m256i upper = _mm256_and_si256(
+        _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), bytes));
+    bytes = _mm256_or_si256(bytes,
+        _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + i), bytes);
+  }
+
+  if ( i < length ) {
+    mask |= ScanScalar(block + i, length - i) << i;
+  }
+  return mask;
+}
+
+static ScanKernel kernel = ScanScalar;
+static const char *kernel_name = "scalar";
+
+void InitTextScan(const std::string &delimiters) {
+
+  for ( size_t c = 0; c < 256; c++ ) {
+    is_delimiter[c] = false;
+  }
+  for ( size_t i = 0; i < 16; i++ ) {
+    low_table[i] = 0;
+    high_table[i] = 0;
+  }
+
+  // The characters are compared before they are made lowercase. The
+  // AVX2 kernel only has 8 bits, so it can only be used if the
+  // delimiters have up to 8 distinct high nibbles.
+  has_avx2_kernel = true;
+  size_t high_bits = 0;
+  for ( size_t i = 0; i < delimiters.size(); i++ ) {
+    unsigned char c = delimiters[i];
+    is_delimiter[c] = true;
+
+    if ( high_table[c >> 4] == 0 ) {
+      if ( high_bits == 8 ) {
+        has_avx2_kernel = false;
+        continue;
+      }
+      high_table[c >> 4] = 1 << high_bits;
+      high_bits++;
+    }
+    low_table[c & 0x0F] |= high_table[c >> 4];
+  }
+
+  has_sse_kernel = delimiters.size() <= 16;
+  if ( has_sse_kernel == true ) {
+    char padded[16] = {0};
+    delimiters.copy(padded, delimiters.size());
+    sse_delimiters = _mm_loadu_si128(reinterpret_cast<__m128i*>(padded));
+    sse_delimiters_size = delimiters.size();
+  }
+
+  kernel = ScanScalar;
+  kernel_name = "scalar";
+  if ( has_avx2_kernel == true && __builtin_cpu_supports("avx2") ) {
+    kernel = ScanAVX2;
+    kernel_name = "avx2";
+  }
+  else if ( has_sse_kernel == true && __builtin_cpu_supports("sse4.2") ) {
+    kernel = ScanSSE42;
+    kernel_name = "sse4.2";
+  }
+}
+
+uint64_t ScanTextBlock(char *block, size_t length) {
+  return kernel(block, length);
+}
+
+const char *GetTextScanKernel() {
+  return kernel_name;
+}
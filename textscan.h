@@ -0,0 +1,24 @@
+#ifndef TEXTSCAN_H
+#define TEXTSCAN_H
+
+#include <string>
+#include <stdint.h>
+
+// The size of the blocks of text scanned at once. A block is described by
+// a 64-bit mask, one bit for every character.
+const size_t scan_block_size = 64;
+
+// Sets the delimiters the text is split on. Must be called before any text
+// is scanned. Picks the fastest kernel the processor supports: AVX2, then
+// SSE4.2 (only for up to 16 delimiters), then the scalar fallback.
+void InitTextScan(const std::string &delimiters);
+
+// Scans up to scan_block_size characters of the text, making every ASCII
+// letter lowercase in place. Returns a mask with the bit i set if the
+// character i of the block is a delimiter.
+uint64_t ScanTextBlock(char *block, size_t length);
+
+// The name of the kernel picked by InitTextScan().
+const char *GetTextScanKernel();
+
+#endif
@@ -0,0 +1,80 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t threads, size_t size, bool background) {
+  queue_size = size > 0 ? size : 1;
+
+  if ( threads > 1 || background == true ) {
+    for ( size_t i = 0; i < threads || i == 0; i++ ) {
+      workers.push_back(std::thread(&ThreadPool::Work, this));
+    }
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_ready.notify_all();
+
+  for ( size_t i = 0; i < workers.size(); i++ ) {
+    workers.at(i).join();
+  }
+}
+
+// Adds a task in the queue, waiting for a free spot if the queue is full.
+// Without workers, the task is run right away.
+void ThreadPool::Submit(std::function<void()> task) {
+
+  if ( workers.empty() ) {
+    task();
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    task_space.wait(lock, [this] { return tasks.size() < queue_size; });
+    tasks.push_back(task);
+    pending++;
+  }
+  task_ready.notify_one();
+}
+
+// Waits until every submitted task has finished.
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  all_done.wait(lock, [this] { return pending == 0; });
+}
+
+size_t ThreadPool::Size() const {
+  return workers.empty() ? 1 : workers.size();
+}
+
+// Every worker takes the oldest task of the queue and runs it, until
+// the pool is destroyed.
+void ThreadPool::Work() {
+  while ( true ) {
+
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      task_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if ( tasks.empty() ) {
+        return;
+      }
+      task = tasks.front();
+      tasks.pop_front();
+    }
+    task_space.notify_one();
+
+    task();
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      pending--;
+      if ( pending == 0 ) {
+        all_done.notify_all();
+      }
+    }
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+
+// A fixed number of worker threads, running the tasks submitted to a
+// bounded queue. Submitting a task blocks while the queue is full, so a
+// producer can never get too far ahead of the workers. With a single
+// thread, no worker is started and the tasks run on the calling thread,
+// in the order they are submitted, unless background is set, for a
+// caller that must never run a task itself.
+class ThreadPool {
+public:
+  ThreadPool(size_t threads, size_t queue_size, bool background = false);
+  ~ThreadPool();
+
+  void Submit(std::function<void()> task);
+  void Wait();
+
+  size_t Size() const;
+
+private:
+  void Work();
+
+  std::vector<std::thread> workers;
+
+  // The tasks waiting for a worker, at most queue_size of them.
+  std::deque<std::function<void()>> tasks;
+  size_t queue_size;
+
+  // The number of tasks that have been submitted and not finished yet.
+  size_t pending = 0;
+  bool stopping = false;
+
+  std::mutex mutex;
+  std::condition_variable task_ready;
+  std::condition_variable task_space;
+  std::condition_variable all_done;
+};
+
+#endif
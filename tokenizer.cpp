@@ -0,0 +1,165 @@
+#include "tokenizer.h"
+#include "textscan.h"
+#include "stopwords.h"
+
+#include <unordered_map>
+#include <algorithm> // std::min
+
+// Delimiters used to split the lines during the parsing of
+// the raw documents
+const std::string delimiters = " .,:;?!><-\"/()";
+
+// The delimiters, along with the line break, used to split the whole
+// text of a raw document at once.
+const std::string line_delimiters = delimiters + "\n";
+
+// The common words discarded from the raw documents. The default words
+// can be replaced by a larger list, loaded from a file.
+StopWords stop_words;
+
+const char *InitTokenizer() {
+  InitTextScan(line_delimiters);
+  return GetTextScanKernel();
+}
+
+// Replaces the default common words with the words of a file.
+bool LoadStopWords(std::string path) {
+  return stop_words.Load(path);
+}
+
+size_t GetStopWordsSize() {
+  return stop_words.Size();
+}
+
+std::string GetStopWords() {
+  return stop_words.GetWords();
+}
+
+// Adds a word of the text in the words, unless it is empty or a common
+// word.
+static void AddRawWord(std::string_view wrd,
+  std::vector<std::string_view> &words) {
+
+  if ( wrd.length() > 0 ) {
+
+    // Discard the word if it is a common word.
+    if ( stop_words.Contains(wrd) == false ) {
+      words.push_back(wrd);
+    }
+
+  }
+}
+
+void TokenizeRaw(char *text, size_t length,
+  std::vector<std::string_view> &words) {
+
+  // Split the text based on delimiters and line breaks.
+  // The text is scanned in blocks, each time getting a mask of the
+  // delimiter characters of the block, while the block is made lowercase.
+  // The start variable serves as a pointer to the start of every word,
+  // and every delimiter found in the mask is the end of a word. Extract
+  // the word and process it. Set the new start value as the position of
+  // the character after the delimiter.
+  size_t start = 0;
+  for ( size_t block = 0; block < length; block += scan_block_size ) {
+
+    size_t block_length = std::min(scan_block_size, length - block);
+    uint64_t mask = ScanTextBlock(text + block, block_length);
+
+    while ( mask != 0 ) {
+      size_t end = block + __builtin_ctzll(mask);
+      AddRawWord(std::string_view(text + start, end - start), words);
+      start = end + 1;
+
+      // Clear the lowest bit of the mask.
+      mask &= mask - 1;
+    }
+  }
+
+  // The last word ends at the end of the text.
+  if ( start < length ) {
+    AddRawWord(std::string_view(text + start, length - start), words);
+  }
+}
+
+void TokenizeParsed(std::string_view text,
+  std::vector<std::string_view> &words) {
+
+  // Split the text in lines. A line break at the end of the text
+  // does not start a new line.
+  size_t line_start = 0;
+  while ( line_start < text.length() ) {
+
+    size_t line_end = text.find('\n', line_start);
+    if ( line_end == std::string_view::npos ) {
+      line_end = text.length();
+    }
+
+    if ( line_start > 0 ) {
+      words.push_back(std::string_view());
+    }
+
+    // Split the line based on the space character.
+    // The start and end variables serve as pointers to the start
+    // and end of every word. Iterate through the line, each time
+    // finding the closest to the start variable, space character.
+    // Extract the word and add it to the words. Set the new start value
+    // as the position of the character after the start. Stop on reaching
+    // the end of the line.
+    std::string_view line = text.substr(line_start, line_end - line_start);
+    size_t start = 0, end;
+    while ( start < line.length() ) {
+
+      // Find where the first space character is located.
+      // If there are no spaces, meaning the returned value was
+      // npos, set the end variable as the end of the line.
+      end = line.find(' ', start);
+      if ( end == std::string_view::npos ) {
+        end = line.length();
+      }
+
+      // Extract the word based on the start and end values.
+      words.push_back(line.substr(start, end - start));
+
+      start = end + 1;
+    }
+
+    line_start = line_end + 1;
+  }
+}
+
+void CountTerms(const std::vector<WordId> &words,
+    TermFrequencies &frequencies) {
+
+  // The position of every term in the frequencies.
+  std::unordered_map<TermKey, size_t> positions;
+  positions.reserve(words.size());
+
+  // Iterate through the words. Set the previous word as the last_word.
+  // Every set of words (as long as they both are not the empty word),
+  // is a new term.
+  for ( size_t i = 1; i < words.size(); i++ ) {
+
+    WordId last_word = words[i - 1];
+    WordId curr_word = words[i];
+
+    if ( curr_word != empty_word && last_word != empty_word ) {
+
+      // Create the term.
+      TermKey term = Vocabulary::MakeTerm(last_word, curr_word);
+
+      // If the term is not in the frequencies, add it. If it
+      // already is, update its frequency.
+      auto found = positions.find(term);
+      if ( found == positions.end() ) {
+        positions.insert(std::make_pair(term, frequencies.size()));
+        frequencies.push_back(std::make_pair(term, 1));
+      }
+      else {
+        frequencies[found->second].second++;
+      }
+
+    }
+
+  }
+}
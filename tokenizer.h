@@ -0,0 +1,50 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include "vocabulary.h"
+
+#include <utility>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Prepares the scanning of the raw documents. Must be called once, before
+// any raw document is tokenized. Returns the name of the kernel used.
+const char *InitTokenizer();
+
+// Replaces the common words discarded from the raw documents with the
+// words of a file, one word per line. Must be called before any raw
+// document is tokenized.
+bool LoadStopWords(std::string path);
+size_t GetStopWordsSize();
+
+// The common words discarded from the raw documents, sorted, each one
+// followed by a line break.
+std::string GetStopWords();
+
+// Splits the text of a raw document based on the delimiters and the line
+// breaks, makes every word lowercase (changing the text in place) and
+// discards the common words. The remaining words are appended to the
+// words vector, as views of the text.
+void TokenizeRaw(char *text, size_t length,
+    std::vector<std::string_view> &words);
+
+// Splits the text of a parsed document in lines, and every line based on
+// the space character. Every word is appended to the words vector as a
+// view of the text, including the empty words found between two
+// consecutive spaces, since they break the terms in two. An empty word
+// is also added between two lines, so no term is created across them.
+void TokenizeParsed(std::string_view text,
+    std::vector<std::string_view> &words);
+
+// The terms of a document, along with their frequency, in the order
+// they were first found in the document.
+typedef std::vector<std::pair<TermKey, size_t>> TermFrequencies;
+
+// Creates the terms of a document from the IDs of its words. Every set of
+// two consecutive words (as long as they both are not the empty word) is
+// a term. Saves every term in the frequencies, along with its frequency.
+void CountTerms(const std::vector<WordId> &words,
+    TermFrequencies &frequencies);
+
+#endif
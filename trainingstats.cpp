@@ -0,0 +1,285 @@
+#include "trainingstats.h"
+#include "tokenizer.h"
+#include "threadpool.h"
+
+#include <iostream>
+#include <math.h>
+
+TrainingStats::TrainingStats(const Corpus &pos, const Corpus &neg,
+    size_t num_threads) : pos_corpus(pos), neg_corpus(neg) {
+  threads = num_threads > 0 ? num_threads : 1;
+}
+
+TrainingStats::~TrainingStats() {}
+
+bool TrainingStats::Build() {
+  // Step 1: Split the positive and negative documents in shards, one
+  // per thread, and gather the terms of every shard in parallel.
+  std::cout << "\tCreating the term maps." << std::endl;
+  std::vector<TermShard> shards;
+  for ( int positive = 1; positive >= 0; positive-- ) {
+    size_t docs = positive ? pos_corpus.Size() : neg_corpus.Size();
+    for ( size_t i = 0; i < threads; i++ ) {
+      TermShard shard;
+      shard.positive = positive;
+      shard.begin = docs * i / threads;
+      shard.end = docs * (i + 1) / threads;
+      shards.push_back(shard);
+    }
+  }
+
+  {
+    ThreadPool pool(threads, shards.size());
+    for ( size_t i = 0; i < shards.size(); i++ ) {
+      TermShard *shard = &shards.at(i);
+      pool.Submit([this, shard] { ParseShard(*shard); });
+    }
+    pool.Wait();
+  }
+
+  // Merge the shards in the term maps, in the order of the documents.
+  // Every shard is released after it is merged.
+  for ( size_t i = 0; i < shards.size(); i++ ) {
+    MergeShard(shards.at(i));
+    TermShard().terms.swap(shards.at(i).terms);
+  }
+
+  std::cout << "\tParsed " << pos_corpus.Size() << " files from ";
+  std::cout << pos_corpus.GetDirectory() << std::endl;
+  std::cout << "\tParsed " << neg_corpus.Size() << " files from ";
+  std::cout << neg_corpus.GetDirectory() << std::endl;
+
+  // Step 2: Calculate the nidf and the weights of the terms.
+  std::cout << "\tFinalizing the hashmaps." << std::endl;
+  if ( Finalize() == false ) {
+    return false;
+  }
+
+  return true;
+}
+
+const std::unordered_map<TermKey, TermInfo2>
+    &TrainingStats::GetTermSet() const {
+  return term_set;
+}
+
+const std::unordered_map<TermKey, TermInfo>
+    &TrainingStats::GetGoodTerms() const {
+  return good_terms;
+}
+
+const std::unordered_map<TermKey, TermInfo>
+    &TrainingStats::GetBadTerms() const {
+  return bad_terms;
+}
+
+const std::vector<std::vector<TermKey>>
+    &TrainingStats::GetGoodDocsTerms() const {
+  return good_docs_terms;
+}
+
+const std::vector<std::vector<TermKey>>
+    &TrainingStats::GetBadDocsTerms() const {
+  return bad_docs_terms;
+}
+
+// The vocabulary shared by the positive and negative documents, used to
+// turn the terms back into strings.
+const Vocabulary &TrainingStats::GetVocabulary() const {
+  return pos_corpus.GetVocabulary();
+}
+
+// For every document of the shard, gather its terms along with their
+// frequency and calculate its maximum frequency. Update the terms map of
+// the shard with the terms of the document. Only the shard is modified,
+// so the shards can be parsed at the same time.
+void TrainingStats::ParseShard(TermShard &shard) const {
+
+  const Corpus &corpus = shard.positive ? pos_corpus : neg_corpus;
+
+  for ( size_t index = shard.begin; index < shard.end; index++ ) {
+
+    // Store every term in the document, along with its frequency.
+    TermFrequencies frequencies;
+    CountTerms(corpus.GetWords(index), frequencies);
+
+    std::vector<TermKey> terms;
+    terms.reserve(frequencies.size());
+
+    // New terms are added to the terms map of the shard, and to the
+    // new_terms in the order they are found. Every term gets a new entry
+    // in its documents vector.
+    size_t max_freq = 0;
+    for ( auto &it_term : frequencies ) {
+
+      auto found_term = shard.terms.find(it_term.first);
+      if ( found_term == shard.terms.end() ) {
+        found_term = shard.terms.insert(
+            std::make_pair(it_term.first, ShardTermInfo())).first;
+        shard.new_terms.push_back(it_term.first);
+      }
+
+      found_term->second.documents.push_back(
+          std::make_pair(index, it_term.second));
+      terms.push_back(it_term.first);
+
+      // Calculate the maximum_frequency of the document
+      if ( it_term.second > max_freq )
+        max_freq = it_term.second;
+    }
+
+    shard.docs_terms.push_back(terms);
+    shard.docs_freq.push_back(max_freq);
+  }
+}
+
+// Using the terms gathered in the shard, update the term_set and the
+// good(bad)_terms maps. The shards are merged in the order of their
+// documents, so new terms are added in the term_set with the same order
+// as if every document was parsed by a single thread, calculated by the
+// size of the term_set. Leave the nidf unset for now. New terms are added
+// to the good(bad)_terms, along with the entries of the documents map of
+// the TermInfo struct, in ascending order of the documents.
+void TrainingStats::MergeShard(TermShard &shard) {
+
+  std::unordered_map<TermKey, TermInfo> &class_terms =
+      shard.positive ? good_terms : bad_terms;
+
+  for ( size_t i = 0; i < shard.new_terms.size(); i++ ) {
+
+    TermKey term = shard.new_terms.at(i);
+
+    // If this term does not exist in the term_set, add it
+    // along with its order.
+    auto found_term = term_set.find(term);
+    if ( found_term == term_set.end() ) {
+      TermInfo2 terminfo;
+      terminfo.order = term_set.size();
+      term_set.insert(std::make_pair(term, terminfo));
+    }
+
+    // If this term does not exist in the good(bad)_terms,
+    // add it, then update the term's documents map.
+    auto found_class = class_terms.find(term);
+    if ( found_class == class_terms.end() ) {
+      found_class = class_terms.insert(
+          std::make_pair(term, TermInfo())).first;
+    }
+
+    const ShardTermInfo &shard_info = shard.terms.at(term);
+    for ( size_t j = 0; j < shard_info.documents.size(); j++ ) {
+      found_class->second.documents.insert(shard_info.documents.at(j));
+    }
+  }
+
+  for ( size_t i = 0; i < shard.docs_terms.size(); i++ ) {
+    std::vector<TermKey> &terms = shard.docs_terms.at(i);
+
+    if ( shard.positive == true ) {
+      good_docs_freq.push_back(shard.docs_freq.at(i));
+      good_docs_terms.push_back(std::move(terms));
+    }
+    else {
+      bad_docs_freq.push_back(shard.docs_freq.at(i));
+      bad_docs_terms.push_back(std::move(terms));
+    }
+  }
+}
+
+// After parsing all positive and negative documents, calculate the nidf
+// for every term in the term_set and the average weight and the total
+// frequency for every term in the good_terms and bad_terms. The documents
+// maps are not needed by the methods, so they are released.
+bool TrainingStats::Finalize() {
+
+  // Calculate the nidf
+  for ( auto &it_term : term_set ) {
+
+    float good_freq = 0, bad_freq = 0;
+
+    // Calculate the number of positive documents the term is found in.
+    auto found_good = good_terms.find(it_term.first);
+    if ( found_good != good_terms.end() ) {
+      good_freq = found_good->second.documents.size();
+    }
+
+    // Calculate the number of negative documents the term is found in.
+    auto found_bad = bad_terms.find(it_term.first);
+    if ( found_bad != bad_terms.end() ) {
+      bad_freq = found_bad->second.documents.size();
+    }
+
+    float nidf = log(train_docs / (good_freq + bad_freq)) / log(train_docs);
+    if ( !(nidf > 0 && nidf <= 1) ) {
+      std::cout << "\tWarning: nidf is " << nidf << std::endl;
+    }
+
+    it_term.second.nidf = nidf;
+
+  }
+
+  // Calculate the average weight and the total frequency for each
+  // term in the good_terms and the bad_terms.
+  if ( FinalizeWeights(good_terms, good_docs_freq.size()) == false ||
+      FinalizeWeights(bad_terms, bad_docs_freq.size()) == false ) {
+    return false;
+  }
+
+  return true;
+}
+
+// Calculates the average weight and the total frequency for each term in
+// the given good(bad)_terms, splitting the terms between the threads.
+// Every thread only updates its own terms, and only reads the term_set.
+bool TrainingStats::FinalizeWeights(
+  std::unordered_map<TermKey, TermInfo> &terms, size_t docs) {
+
+  std::vector<std::pair<const TermKey, TermInfo>*> entries;
+  entries.reserve(terms.size());
+  for ( auto &it_term : terms ) {
+    entries.push_back(&it_term);
+  }
+
+  // The first invalid weight found by every thread, or 0 if none.
+  std::vector<float> invalid(threads, 0);
+
+  ThreadPool pool(threads, threads);
+  for ( size_t t = 0; t < threads; t++ ) {
+    pool.Submit([this, t, docs, &entries, &invalid] {
+      size_t begin = entries.size() * t / threads;
+      size_t end = entries.size() * (t + 1) / threads;
+      for ( size_t i = begin; i < end; i++ ) {
+
+        TermInfo &terminfo = entries.at(i)->second;
+
+        float weight_sum = 0;
+        size_t freq_sum = 0;
+        float nidf = term_set.find(entries.at(i)->first)->second.nidf;
+
+        for ( auto it_doc : terminfo.documents ) {
+          weight_sum += it_doc.second * nidf;
+          freq_sum += it_doc.second;
+        }
+
+        terminfo.weight = weight_sum / docs;
+        terminfo.freq = freq_sum;
+        if ( terminfo.weight < 0 || terminfo.weight > 1 ) {
+          invalid.at(t) = terminfo.weight;
+          return;
+        }
+        std::unordered_map<size_t, size_t>().swap(terminfo.documents);
+      }
+    });
+  }
+  pool.Wait();
+
+  for ( size_t t = 0; t < threads; t++ ) {
+    if ( invalid.at(t) != 0 ) {
+      std::cout << "\tError: Found invalid weight value ";
+      std::cout << invalid.at(t) << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,117 @@
+#ifndef TRAININGSTATS_H
+#define TRAININGSTATS_H
+
+#include "corpus.h"
+
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+// Used as a value in the term_set unordered map. Contains a number
+// corresponding to which order this term was added to the term_set map.
+// It basically works as an index used for the construction of the vectors
+// later on. It also contains a number which if the nidf value for this term.
+// This is an average nidf for both the pos and neg documents and the value is:
+// ln((pos_docs+neg_docs) / (occurances_in_pos_docs+occurances_in_neg_docs))
+// divided by ln(pos_docs+neg_docs)
+struct TermInfo2 {
+  size_t order;
+  float nidf;
+};
+
+// Used as a value in the good_terms/bad_terms unordered maps.
+// Contains the average weight of a term, calculated like this:
+// (ntf(1)*nidf + ntf(2)*nidf + ... + ntf(m)*nidf) / pos(neg)_docs
+// where m is the positive (negative) documents this term is found in.
+// Also contains the total frequency of the term in all the positive
+// (negative) documents. The IDs of every document the term is found in,
+// along with the frequency for each document, are only kept while the
+// statistics are gathered.
+struct TermInfo {
+  float weight;
+  size_t freq;
+  std::unordered_map<size_t, size_t> documents;
+};
+
+// Used as a value in the terms map of a TermShard. Stores the documents of
+// the shard the term is found in, along with the frequency for each
+// document, in ascending order of the documents.
+struct ShardTermInfo {
+  std::vector<std::pair<size_t, size_t>> documents;
+};
+
+// The terms gathered by a single worker from a range of documents of the
+// positive (negative) directory, before they are merged in the term_set
+// and the good(bad)_terms maps. The new_terms vector keeps the terms in
+// the order they were first found, so the merge can add them in the
+// term_set in the same order as a single thread would.
+struct TermShard {
+  bool positive;
+  size_t begin;
+  size_t end;
+  std::unordered_map<TermKey, ShardTermInfo> terms;
+  std::vector<TermKey> new_terms;
+  std::vector<std::vector<TermKey>> docs_terms;
+  std::vector<size_t> docs_freq;
+};
+
+// Gathers the statistics of the training documents that are shared by all
+// the methods, reading the positive and negative documents only once.
+// The methods use the term_set, the good(bad)_terms and the terms of
+// every document, instead of building their own copies of them.
+// The documents are split in shards, which are parsed by a pool of
+// worker threads into thread-local tables, and then merged in order.
+class TrainingStats {
+public:
+  TrainingStats(const Corpus &pos, const Corpus &neg, size_t threads);
+  ~TrainingStats();
+
+  bool Build();
+
+  const std::unordered_map<TermKey, TermInfo2> &GetTermSet() const;
+  const std::unordered_map<TermKey, TermInfo> &GetGoodTerms() const;
+  const std::unordered_map<TermKey, TermInfo> &GetBadTerms() const;
+  const std::vector<std::vector<TermKey>> &GetGoodDocsTerms() const;
+  const std::vector<std::vector<TermKey>> &GetBadDocsTerms() const;
+  const Vocabulary &GetVocabulary() const;
+
+private:
+  void ParseShard(TermShard &shard) const;
+  void MergeShard(TermShard &shard);
+  bool Finalize();
+  bool FinalizeWeights(std::unordered_map<TermKey, TermInfo> &terms,
+      size_t docs);
+
+  // The number of threads used to gather the statistics.
+  size_t threads;
+
+  // The words of the positive and negative documents.
+  const Corpus &pos_corpus;
+  const Corpus &neg_corpus;
+
+  // Stores the total unique terms from both the positive and negative
+  // documents, along with information for the order added and the nidf
+  // of the term. For more info, refer to the TermInfo2 comments.
+  std::unordered_map<TermKey, TermInfo2> term_set;
+
+  size_t train_docs = 25000;
+
+  // Stores the maximum frequency for every positive document.
+  std::vector<size_t> good_docs_freq;
+
+  // Stores the maximum frequency for every negative document.
+  std::vector<size_t> bad_docs_freq;
+
+  // Stores every unique term from the positive (negative) documents,
+  // along with information about the average weight of the term, and
+  // its total frequency. For more info, refer to the TermInfo comments.
+  std::unordered_map<TermKey, TermInfo> good_terms;
+  std::unordered_map<TermKey, TermInfo> bad_terms;
+
+  // Stores the terms for each document, in the order they were first
+  // found in the document.
+  std::vector<std::vector<TermKey>> good_docs_terms;
+  std::vector<std::vector<TermKey>> bad_docs_terms;
+};
+
+#endif
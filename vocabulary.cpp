@@ -0,0 +1,93 @@
+#include "vocabulary.h"
+
+Vocabulary::Vocabulary() {
+  words.push_back("");
+  ids.insert(std::make_pair(std::string_view(words.back()), empty_word));
+}
+
+Vocabulary::~Vocabulary() {}
+
+// Returns the ID of the word, giving it a new ID if it is a new word.
+WordId Vocabulary::Intern(std::string_view word) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return InternLocked(word);
+}
+
+// Gets the ID of every word of a document, locking the vocabulary
+// only once for the whole document.
+void Vocabulary::Intern(const std::vector<std::string_view> &doc_words,
+  std::vector<WordId> &doc_ids) {
+
+  doc_ids.reserve(doc_ids.size() + doc_words.size());
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for ( size_t i = 0; i < doc_words.size(); i++ ) {
+    doc_ids.push_back(InternLocked(doc_words[i]));
+  }
+}
+
+// Only a new word is copied, the key of the ids map being a view of the
+// copy kept in the words.
+WordId Vocabulary::InternLocked(std::string_view word) {
+  auto found = ids.find(word);
+  if ( found != ids.end() ) {
+    return found->second;
+  }
+
+  WordId id = words.size();
+  words.push_back(std::string(word));
+  ids.insert(std::make_pair(std::string_view(words.back()), id));
+  return id;
+}
+
+// Gets the ID of a word, without adding it if it is a new word.
+bool Vocabulary::Find(std::string_view word, WordId &id) const {
+  std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+  if ( frozen.load(std::memory_order_acquire) == false ) {
+    lock.lock();
+  }
+  auto found = ids.find(word);
+  if ( found == ids.end() ) {
+    return false;
+  }
+  id = found->second;
+  return true;
+}
+
+std::string Vocabulary::GetWord(WordId id) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return words.at(id);
+}
+
+// Returns the term as a string, the two words seperated by a space.
+std::string Vocabulary::GetTerm(TermKey term) const {
+  return GetWord(term >> 32) + " " + GetWord(term & 0xFFFFFFFF);
+}
+
+size_t Vocabulary::Size() const {
+  std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+  if ( frozen.load(std::memory_order_acquire) == false ) {
+    lock.lock();
+  }
+  return words.size();
+}
+
+// Forgets every word, except the empty word, which keeps the ID 0.
+void Vocabulary::Clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  ids.clear();
+  words.clear();
+  words.push_back("");
+  ids.insert(std::make_pair(std::string_view(words.back()), empty_word));
+}
+
+// Forbids adding words from now on, so Find() and Size() no longer lock.
+// No thread may be adding a word anymore, and none may ever again.
+void Vocabulary::Freeze() {
+  std::lock_guard<std::mutex> lock(mutex);
+  frozen.store(true, std::memory_order_release);
+}
+
+TermKey Vocabulary::MakeTerm(WordId first, WordId second) {
+  return (static_cast<TermKey>(first) << 32) | second;
+}
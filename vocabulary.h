@@ -0,0 +1,60 @@
+#ifndef VOCABULARY_H
+#define VOCABULARY_H
+
+#include <atomic>
+#include <unordered_map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+// Every distinct word is given a 32-bit ID, and a term (a set of two
+// consecutive words) is keyed by the IDs of its two words, packed in a
+// 64-bit integer. The ID 0 is reserved for the empty word, which never
+// forms a term.
+typedef uint32_t WordId;
+typedef uint64_t TermKey;
+
+const WordId empty_word = 0;
+
+// Maps every word found in the documents to its ID. The words are only
+// turned back into strings for debugging, or when they are exported.
+// Words can be added by many threads at the same time. Once frozen, no
+// word is ever added again, so the words are looked up without locking.
+class Vocabulary {
+public:
+  Vocabulary();
+  ~Vocabulary();
+
+  WordId Intern(std::string_view word);
+  void Intern(const std::vector<std::string_view> &words,
+      std::vector<WordId> &ids);
+  bool Find(std::string_view word, WordId &id) const;
+
+  std::string GetWord(WordId id) const;
+  std::string GetTerm(TermKey term) const;
+  size_t Size() const;
+  void Clear();
+  void Freeze();
+
+  static TermKey MakeTerm(WordId first, WordId second);
+
+private:
+  WordId InternLocked(std::string_view word);
+
+  mutable std::mutex mutex;
+
+  // Set once no word can be added anymore. The map and the words are
+  // then only read, which needs no lock.
+  std::atomic<bool> frozen{false};
+
+  // The ID of every word, and the word of every ID. The keys of the ids
+  // map are views of the words, which never move since they are stored
+  // in a deque.
+  std::unordered_map<std::string_view, WordId> ids;
+  std::deque<std::string> words;
+};
+
+#endif